@@ -0,0 +1,110 @@
+#pragma once
+
+#include <ecs.hpp>
+
+#include <vector>
+
+namespace BasicECS{
+
+    constexpr std::size_t CommandBufferBlockSize = 16 * 1024;
+
+    class CommandBuffer{
+    public:
+        /**
+         * @brief Creates an empty command buffer 
+         */
+        CommandBuffer();
+        /**
+         * @brief Destroys the recorded components 
+         */
+        ~CommandBuffer();
+
+        CommandBuffer(const CommandBuffer&) = delete;
+        CommandBuffer& operator=(const CommandBuffer&) = delete;
+
+        /**
+         * @brief Records adding a new entity, components added to the cached entity are added to it (caches entity)
+         * @return A reference to the command buffer
+         */
+        CommandBuffer& addEntity();
+        /**
+         * @brief Records removing an entity, entities are removed after all the component commands
+         * @param entityID The id of the entity to remove
+         * @return A reference to the command buffer
+         */
+        CommandBuffer& removeEntity(EntityID entityID);
+
+        /**
+         * @brief Records adding a component to an entity (caches entity)
+         * @param entityID The ID of the entity to add the component
+         * @param component The component
+         * @return A reference to the command buffer
+         */
+        template <typename T> CommandBuffer& addComponent(EntityID entityID, T component);
+        /**
+         * @brief Records adding a component to the cached entity
+         * @param component The component
+         * @return A reference to the command buffer
+         */
+        template <typename T> CommandBuffer& addComponent(T component);
+        /**
+         * @brief Records removing a component from an entity, nothing happens if the entity doesn't have it when flushed
+         * @tparam T Component type to remove
+         * @param entityID The ID of the entity to remove this component
+         * @return A reference to the command buffer
+         */
+        template <typename T> CommandBuffer& removeComponent(EntityID entityID);
+
+        /**
+         * @brief Checks if there are no recorded commands
+         * @return If the command buffer is empty
+         */
+        bool isEmpty();
+        /**
+         * @brief Discards all the recorded commands 
+         */
+        void clear();
+
+    private:
+        friend class ECS;
+
+        using AddComponentFunc = void (*)(ECS &ecs, EntityID entityID, void *component);
+        using DestroyComponentFunc = void (*)(void *component);
+
+        enum class CommandType { AddComponent, RemoveComponent, RemoveEntity };
+
+        // Commands on entities added by this buffer use the index of the new entity as the entity ID
+        struct Command {
+            CommandType type;
+            EntityID entityID;
+            bool isNewEntity;
+            TypeID typeId;
+
+            void *component;
+            AddComponentFunc addComponentFunc;
+            DestroyComponentFunc destroyComponentFunc;
+        };
+        // Components are stored in blocks that are reused after each flush
+        struct Block {
+            uint8_t *data;
+            std::size_t size;
+            std::size_t alignment;
+        };
+
+        void* allocateComponent(std::size_t size, std::size_t alignment);
+        void addCommand(CommandType type, EntityID entityID, bool isNewEntity, TypeID typeId);
+
+    private:
+        std::vector<Command> commands;
+        std::size_t newEntityCount = 0;
+
+        EntityID cachedEntity = 0;
+        bool isCachedEntityNew = false;
+
+        std::vector<Block> blocks;
+        std::size_t currentBlock = 0;
+        std::size_t blockOffset = 0;
+    };
+}
+
+#include "commandBuffer.tpp"
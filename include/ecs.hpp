@@ -1,46 +1,119 @@
 #pragma once
 
 #include <componentMap.hpp>
+#include <jobSystem.hpp>
+#include <allocator.hpp>
+#include <serialization.hpp>
 
 #include <unordered_map>
 #include <vector>
+#include <bitset>
 #include <functional>
+#include <utility>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <shared_mutex>
+#include <thread>
+#include <iosfwd>
+#include <string>
 
 namespace BasicECS{
 
     class ECS;
+    class CommandBuffer;
+    template <typename... Ts> class Query;
+    class SnapshotWriter;
+    class SnapshotReader;
 
     using TypeID = std::size_t;
     using EntityID = std::size_t;
     using EntityGUID = uint64_t;
 
     constexpr std::size_t RootEntityID = -1;
+    constexpr std::size_t ArchetypeChunkSize = 16 * 1024;
+    constexpr std::size_t ArchetypeChunkAlignment = 64;
+    constexpr std::size_t MaxComponentTypes = 256;
+    constexpr std::size_t DefaultGrainSize = 4096;
+    constexpr std::size_t SnapshotChunkAlignment = 4096;
+
+    // Entity IDs hold the index of the entity in the lower bits and the generation of that index in the upper bits.
+    // Removing an entity changes the generation of its index, so old IDs of a reused index are invalid.
+    constexpr std::size_t EntityIndexBits = 32;
+    constexpr std::size_t EntityIndexMask = (std::size_t(1) << EntityIndexBits) - 1;
+
+    using ComponentSignature = std::bitset<MaxComponentTypes>;
 
     using InitialiseFunc = void (*)(ECS &ecs, EntityID entity);
     using DeinitializeFunc = void (*)(ECS &ecs, EntityID entity);
-    using SerializeFunc = std::vector<uint8_t> (*)(ECS &ecs, EntityID entity);
-    using DeserializeFunc = void (*)(ECS &ecs, EntityID entity, const std::vector<uint8_t> data);
+    using SerializeFunc = void (*)(ECS &ecs, EntityID entity, Writer &writer);
+    using DeserializeFunc = void (*)(ECS &ecs, EntityID entity, Reader &reader);
+
+    // The change ticks of a component, ticks are counted by the ecs and only move forward
+    struct ComponentTicks{
+        uint32_t added;
+        uint32_t changed;
+    };
 
+    /**
+     * @brief Query term for entities whose component was added after the query's since tick, the component is passed like T
+     */
+    template <typename T> struct Added {};
+    /**
+     * @brief Query term for entities whose component was added or changed after the query's since tick, the component is passed like T
+     */
+    template <typename T> struct Changed {};
+    /**
+     * @brief Query term for entities without the component, nothing is passed for it
+     */
+    template <typename T> struct Without {};
+    /**
+     * @brief Query term for a component the entities may not have, the component is passed like T* and is nullptr when the entity doesn't have it
+     */
+    template <typename T> struct Optional {};
+    /**
+     * @brief Query term for entities with at least one of the components, nothing is passed for it (use Optional<T> to read them)
+     */
+    template <typename... Ts> struct AnyOf {};
+
+    // Serialize functions should read with getComponent<const T> so serializing doesn't mark components as changed
     struct ComponentFunctions{
         InitialiseFunc initialiseFunc = nullptr;
         DeinitializeFunc deinitializeFunc = nullptr;
         SerializeFunc serializeFunc = nullptr;
         DeserializeFunc deserializeFunc = nullptr;
+        // Stable components are kept out of the archetype chunks in pages of their type, their address doesn't
+        // change until they are removed from the entity but iterating them follows a pointer
+        bool isStable = false;
     };
 
     template<typename T>
     struct Reference{
         TypeID typeId;
         EntityGUID entityGUID;
+
+        // The resolved component, used until the archetype that stores it changes
+        mutable T *component = nullptr;
+        mutable ComponentTicks *ticks = nullptr;
+        mutable std::size_t changeTickIndex = 0;
+        mutable std::size_t archetype = 0;
+        mutable uint64_t archetypeVersion = 0;
     };
 
     class ECS{
     public:
+        /**
+         * @brief Creates an empty ecs 
+         */
+        ECS();
         /**
          * @brief Terminates the ecs 
          */
         ~ECS();
 
+        ECS(const ECS&) = delete;
+        ECS& operator=(const ECS&) = delete;
+
         /**
          * @brief Clears the ecs of all entities and components 
          */
@@ -78,16 +151,37 @@ namespace BasicECS{
          */
         ECS& addEntity();
         /**
-         * @brief Removes an entity from the ecs 
+         * @brief Adds many entities with the same components at once, the entities are stored next to each other (caches the last entity)
+         * @tparam Ts Component types to add
+         * @param count The number of entities to add
+         * @param components The components that are copied to every new entity 
+         * @return The IDs of the new entities
+         */
+        template <typename... Ts> std::vector<EntityID> createEntities(std::size_t count, const Ts&... components);
+        /**
+         * @brief Removes an entity and all its children from the ecs 
          * @param entityID The id of the entity to remove
          * @return A reference to the ecs
          */
         ECS& removeEntity(EntityID entityID);
+        /**
+         * @brief Removes many entities and all their children from the ecs at once, faster than removing them one by one
+         * @param entityIDs The ids of the entities to remove
+         * @return A reference to the ecs
+         */
+        ECS& removeEntities(const std::vector<EntityID> &entityIDs);
+
+        /**
+         * @brief Checks if an entity ID refers to an entity that hasn't been removed
+         * @param entityID The ID of the entity to check
+         * @return If the entity exists
+         */
+        bool isEntityValid(EntityID entityID);
 
         /**
-         * @brief Append a child entity to an entity
+         * @brief Append a child entity to an entity, the child is taken from its old parent
          * @param entityID The entity to append the child entity to 
-         * @param childEntityID The child entity to append to the entity
+         * @param childEntityID The child entity to append to the entity (not the entity or one of its ancestors)
          * @return A reference to the ecs
          */
         ECS& appendChild(EntityID entityID, EntityID childEntityID);
@@ -103,6 +197,30 @@ namespace BasicECS{
          * @return A list of the child entity IDs
          */
         std::vector<EntityID> getChildEntityIDs(EntityID entityID);
+        /**
+         * @brief Iterates over the children of an entity in the order they were appended, without copying them
+         * @param entityID The entity to iterate the children of
+         * @param routine The function for each child (function parameters: EntityID childEntityID)
+         */
+        template <typename Func> void forEachChild(EntityID entityID, Func &&routine);
+        /**
+         * @brief Iterates over every entity with a parent or children, parents before their children in one pass over a flat breadth first order.
+         * The order is rebuilt after the hierarchy changes, don't change the hierarchy in the routine
+         * @param routine The function for each entity (function parameters: EntityID entityID, EntityID parentEntityID), roots have RootEntityID as their parent
+         */
+        template <typename Func> void forEachInHierarchy(Func &&routine);
+        /**
+         * @brief Propagates a component from parents to their children (e.g. local to world transforms) for the entities in a hierarchy.
+         * Each level of the hierarchy is split across the threads of the job system after the level above it is finished.
+         * Only entities whose Source changed, whose parent changed or whose parent's Target changed after sinceTick are visited,
+         * they are found from the change ticks of the Target archetypes and unchanged subtrees are skipped
+         * @tparam Source The component of the entity's own value (e.g. a local transform)
+         * @tparam Target The component that is written and marked as changed (e.g. a world transform), entities sharing it are skipped
+         * @param sinceTick The tick of the last propagation, usually the tick returned by advanceChangeTick (0 visits every entity)
+         * @param routine The function for each entity, called from many threads at once (function parameters: const Source &source, const Target *parentTarget, Target &target), parentTarget is nullptr for roots and parents without Target
+         * @param grainSize The number of entities of a level in each job
+         */
+        template <typename Source, typename Target, typename Func> void propagateHierarchy(uint32_t sinceTick, Func &&routine, std::size_t grainSize = DefaultGrainSize);
         
         /**
          * @brief Creates a reference of a component 
@@ -153,6 +271,38 @@ namespace BasicECS{
          * @return A reference to the ecs
          */
         template <typename T> ECS& addComponent(EntityID parentEntityID);
+        /**
+         * @brief Add a shared value component to an entity, entities given equal values share one copy of the value (caches entity).
+         * The value isn't tied to an entity, it's removed with the last entity sharing it. Writing it with getComponent or a non const query term gives
+         * the entity its own copy first if other entities share it, read it through const terms to keep it shared
+         * @tparam T Component type, values are only deduplicated if T has operator== and std::hash or can be compared by its bytes
+         * @param entityID The ID of the entity to add the shared component
+         * @param component The value to share
+         * @return A reference to the ecs
+         */
+        template <typename T> ECS& addSharedComponent(EntityID entityID, T component);
+        /**
+         * @brief Add a shared value component to the cached entity, entities given equal values share one copy of the value
+         * @tparam T Component type
+         * @param component The value to share
+         * @return A reference to the ecs
+         */
+        template <typename T> ECS& addSharedComponent(T component);
+        /**
+         * @brief Gets the number of entities that share the component of an entity, including the entity
+         * @tparam T Component type
+         * @param entityID The ID of the entity
+         * @return The number of sharers, 1 if the component isn't shared
+         */
+        template <typename T> std::size_t getSharerCount(EntityID entityID);
+        /**
+         * @brief Adds a component to many entities at once
+         * @tparam T Component type to add
+         * @param entityIDs The IDs of the entities to add the components (each entity once)
+         * @param components The components, one for each entity in the same order
+         * @return A reference to the ecs
+         */
+        template <typename T> ECS& addComponents(const std::vector<EntityID> &entityIDs, std::vector<T> components);
         /**
          * @brief Removes a component from an entity
          * @tparam T Component type to remove
@@ -162,15 +312,24 @@ namespace BasicECS{
         template <typename T> ECS& removeComponent(EntityID entityID);
 
         /**
-         * @brief Gets a component from an entity
-         * @tparam T Component type to get 
+         * @brief Checks if an entity has a component
+         * @tparam T Component type to check
+         * @param entityID The ID of the entity to check
+         * @return If the entity has the component
+         */
+        template <typename T> bool hasComponent(EntityID entityID);
+        /**
+         * @brief Gets a component from an entity (the reference is invalidated when the archetype of the entity changes or an entity is removed from it, stable components stay valid until they are removed).
+         * Getting a shared value through a non const type can copy it to a new hidden entity, which is a structural change, so it can't be done
+         * from a parallel job and throws in scheduler systems that aren't exclusive
+         * @tparam T Component type to get, a non const type marks the component as changed
          * @param entityID The ID of the entity to get the component from 
          * @return A reference to the requested component 
          */
         template <typename T> T& getComponent(EntityID entityID);
         /**
          * @brief Gets the only instance of this component
-         * @tparam T Component type to get 
+         * @tparam T Component type to get, a non const type marks the component as changed
          * @return A reference to the requested component 
          */
         template <typename T> T& getComponent();
@@ -182,27 +341,103 @@ namespace BasicECS{
         template <typename T> bool isSingular();
 
         /**
-         * @brief Gets a component from an reference
-         * @tparam T Component type to get
+         * @brief Gets a component from an reference, the component is cached in the reference until its storage changes (don't resolve the same reference from many threads)
+         * @tparam T Component type to get, a non const type marks the component as changed
          * @param reference The reference to get the component from 
          * @return A reference to the requested component 
          */
-        template <typename T> T& getComponent(Reference<T> reference);
+        template <typename T> T& getComponent(const Reference<T> &reference);
         /**
          * @brief Serializes a component 
          * @param componentTypeID The TypeID of the component
          * @param entityID The entity of the component to serialize
          * @return A vector of the serialized components' bytes 
          */
-
         std::vector<uint8_t> serializeComponent(TypeID componentTypeID, EntityID entityID);
+        /**
+         * @brief Serializes a component into a writer, use one writer buffer for many components to avoid allocations
+         * @param componentTypeID The TypeID of the component
+         * @param entityID The entity of the component to serialize
+         * @param writer The writer to append the serialized component to
+         */
+        void serializeComponent(TypeID componentTypeID, EntityID entityID, Writer &writer);
         /**
          * @brief Deserializes a component 
          * @param componentTypeID The TypeID of the component
          * @param entityID The entity to add the deserialized component
          * @param componentData The serialized component data to deserialize
          */
-        void deserializeComponent(TypeID componentTypeID, EntityID entityID, const std::vector<uint8_t> componentData);
+        void deserializeComponent(TypeID componentTypeID, EntityID entityID, const std::vector<uint8_t> &componentData);
+        /**
+         * @brief Deserializes a component from a reader, the reader is left after the component's bytes
+         * @param componentTypeID The TypeID of the component
+         * @param entityID The entity to add the deserialized component
+         * @param reader The reader to read the serialized component from
+         */
+        void deserializeComponent(TypeID componentTypeID, EntityID entityID, Reader &reader);
+
+        /**
+         * @brief Writes every entity with its GUID, hierarchy and components to a binary snapshot
+         * @param stream The stream to write the snapshot to (opened in binary mode)
+         */
+        void saveSnapshot(std::ostream &stream);
+        /**
+         * @brief Writes every entity with its GUID, hierarchy and components to a binary snapshot file
+         * @param path The path of the snapshot file
+         */
+        void saveSnapshot(const std::string &path);
+        /**
+         * @brief Replaces all the entities and components with the ones in a binary snapshot, entity IDs are kept
+         * @param stream The stream to read the snapshot from (opened in binary mode), the component types in it must already be added
+         */
+        void loadSnapshot(std::istream &stream);
+        /**
+         * @brief Replaces all the entities and components with the ones in a binary snapshot file, entity IDs are kept.
+         * The file is memory mapped, chunks of trivial components are used from the mapping (copy on write) until the ecs is cleared.
+         * If the file can't be read the ecs is left empty
+         * @param path The path of the snapshot file, the component types in it must already be added
+         */
+        void loadSnapshot(const std::string &path);
+
+        /**
+         * @brief Gets the current change tick, components added or changed now are stamped with it
+         * @return The current change tick
+         */
+        uint32_t getChangeTick();
+        /**
+         * @brief Ends the current change tick, later changes are stamped with a bigger tick
+         * @return The tick that ended, everything done until now is at or before it
+         */
+        uint32_t advanceChangeTick();
+        /**
+         * @brief Marks a component as changed at the current tick (for changes made without getting the component as non const)
+         * @tparam T Component type to mark
+         * @param entityID The entity of the component, shared components mark their owner
+         */
+        template <typename T> void markChanged(EntityID entityID);
+        /**
+         * @brief Gets the ticks when a component was added and last changed
+         * @tparam T Component type
+         * @param entityID The entity of the component, shared components give their owner's ticks
+         * @return The ticks of the component
+         */
+        template <typename T> ComponentTicks getComponentTicks(EntityID entityID);
+        /**
+         * @brief Forgets the removed entities and components logged at or before a tick, call it once every consumer of the removals has seen them
+         * @param tick The last tick to forget
+         */
+        void clearRemovals(uint32_t tick);
+        /**
+         * @brief Writes the components added or changed and the entities and components removed after a tick, entities are identified by their GUIDs
+         * @param stream The stream to write the delta to (opened in binary mode)
+         * @param sinceTick Only changes after this tick are written, usually the tick returned by advanceChangeTick after the last delta
+         */
+        void saveDelta(std::ostream &stream, uint32_t sinceTick);
+        /**
+         * @brief Applies a delta, entities are matched by GUID and missing entities are added
+         * @param stream The stream to read the delta from (opened in binary mode), the component types in it must already be added
+         */
+        void loadDelta(std::istream &stream);
 
         /**
          * @brief Iterates over all the entities 
@@ -216,31 +451,77 @@ namespace BasicECS{
          */
         void forEachComponent(EntityID entityID ,std::function<void(TypeID componentTypeID)> routine);
         /**
-         * @brief Iterates over all the entities with the specified component 
-         * @tparam T Component type to iterate over
-         * @param routine The function for each iteration (function parameters: T &component)
+         * @brief Iterates over all the entities with the specified components
+         * @tparam Ts Component types to iterate over or Without<T>, Optional<T> and AnyOf<Ts...> terms, components of non const types are marked as changed
+         * and shared values of non const types are copied for each visited entity first like getComponent does (only from exclusive systems).
+         * The routine can't add or remove entities and components, record them with getCommandBuffer and flush them after the iteration
+         * @param routine The function for each iteration (function parameters: Ts &...components or Ts &...components, EntityID entityID)
          */
-        template <typename T> void forEach(std::function<void(T &component)> routine);
+        template <typename... Ts, typename Func> void forEach(Func &&routine);
         /**
-         * @brief Iterates over all the entities with the specified component
-         * @tparam T Component type to iterate over
-         * @param routine The function for each iteration (function parameters: T &component, EntityID entityID)
+         * @brief Iterates over the entities with the specified components whose Added and Changed terms changed after a tick
+         * @tparam Ts Component types or Added<T>, Changed<T>, Without<T>, Optional<T> and AnyOf<Ts...> terms, shared components are changed when they are shared or their owner changes
+         * @param sinceTick The tick the caller last iterated at, usually the tick returned by advanceChangeTick
+         * @param routine The function for each iteration (function parameters: Ts &...components or Ts &...components, EntityID entityID, with T in place of the terms)
          */
-        template <typename T> void forEach(std::function<void(T &component, EntityID entityID)> routine);
+        template <typename... Ts, typename Func> void forEach(uint32_t sinceTick, Func &&routine);
         /**
-         * @brief Iterates over all the entities with the specified components
-         * @tparam T1 Component type to iterate over
-         * @tparam T2 Component type to iterate over
-         * @param routine The function for each iteration (function parameters: T1 &component1, T2 &component2)
+         * @brief Iterates over all the entities with the specified components on the threads of the job system
+         * @tparam Ts Component types to iterate over or Without<T>, Optional<T> and AnyOf<Ts...> terms, components of non const types are marked as changed.
+         * Shared components can only be iterated through const terms since writing them can copy the value (write them with forEach)
+         * @param routine The function for each iteration, called from many threads at once (function parameters: Ts &...components or Ts &...components, EntityID entityID)
+         * @param grainSize The number of entities in each job, jobs are split the same way every time for the same entities
          */
-        template <typename T1, typename T2> void forEach(std::function<void(T1 &component1, T2 &component2)> routine);
+        template <typename... Ts, typename Func> void parallelForEach(Func &&routine, std::size_t grainSize = DefaultGrainSize);
         /**
-         * @brief Iterates over all the entities with the specified components
-         * @tparam T1 Component type to iterate over
-         * @tparam T2 Component type to iterate over
-         * @param routine The function for each iteration (function parameters: T1 &component1, T2 &component2, EntityID entityID)
+         * @brief Iterates over the entities with the specified components whose Added and Changed terms changed after a tick on the threads of the job system
+         * @tparam Ts Component types or Added<T>, Changed<T>, Without<T>, Optional<T> and AnyOf<Ts...> terms
+         * @param sinceTick The tick the caller last iterated at, usually the tick returned by advanceChangeTick
+         * @param routine The function for each iteration, called from many threads at once (function parameters: Ts &...components or Ts &...components, EntityID entityID, with T in place of the terms)
+         * @param grainSize The number of entities in each job, jobs are split before the rows are filtered
+         */
+        template <typename... Ts, typename Func> void parallelForEach(uint32_t sinceTick, Func &&routine, std::size_t grainSize = DefaultGrainSize);
+        /**
+         * @brief Iterates over the entities that had a component removed after a tick, in the order of removal (until the removals are cleared)
+         * @tparam T Component type
+         * @param sinceTick The tick the caller last iterated at, usually the tick returned by advanceChangeTick
+         * @param routine The function for each removal (function parameters: EntityID entityID), the entity may have been removed or may have the component again
          */
-        template <typename T1, typename T2> void forEach(std::function<void(T1 &component1, T2 &component2, EntityID entityID)> routine);
+        template <typename T, typename Func> void forEachRemoved(uint32_t sinceTick, Func &&routine);
+        /**
+         * @brief Creates a query that keeps the archetypes it matches, use it for queries that run every frame. forEach finds the same
+         * matches by looking up its component types, queries of the same component types share their matches
+         * @tparam Ts Component types or Added<T>, Changed<T>, Without<T>, Optional<T> and AnyOf<Ts...> terms
+         * @return The query
+         */
+        template <typename... Ts> Query<Ts...> createQuery();
+
+        /**
+         * @brief Gets the command buffer of the calling thread, use it to add and remove entities and components while iterating
+         * @return A reference to the command buffer
+         */
+        CommandBuffer& getCommandBuffer();
+        /**
+         * @brief Applies the commands of every thread's command buffer, component commands are applied grouped by component type then entities are removed (call it when nothing is iterating or recording commands)
+         */
+        void flushCommands();
+
+        /**
+         * @brief Sets the job system used for parallel iteration (the default job system is used otherwise)
+         * @param jobSystem The job system, it must outlive the ecs
+         */
+        void setJobSystem(JobSystem &jobSystem);
+        /**
+         * @brief Gets the job system used for parallel iteration
+         * @return A reference to the job system
+         */
+        JobSystem& getJobSystem();
+        /**
+         * @brief Sets the allocator the archetype chunks come from (the global heap is used otherwise), call it before adding entities.
+         * Chunks are pooled by the ecs, so adding and removing entities reuses chunks and the memory is freed at once when the ecs is destroyed
+         * @param allocator The allocator, it must outlive the ecs
+         */
+        void setAllocator(Allocator &allocator);
 
         /**
          * @brief Display the component types, entities and components
@@ -254,87 +535,362 @@ namespace BasicECS{
          */
         TypeID getTypeID(std::string typeName);
         /**
-         * @brief Gets the ID of a component type 
+         * @brief Gets the ID of a component type (IDs are small and dense, assigned in order of first use so use names when serializing)
          * @tparam T The component type to get the ID of 
-         * @param routine The function for each iteration (function parameters: T1 &component1, T2 &component2, EntityID entityID)
+         * @return the ID of the component type
          */
         template <typename T>  static TypeID getTypeID();
 
     private:
-        struct Component {
-            std::size_t componentIndex;
-            EntityID parent;
-        };
         struct Entity{
-            ComponentMap<Component> components;
+            std::size_t archetype = 0;
+            std::size_t archetypeRow = 0;
             EntityGUID entityGUID = 0;
             bool isTombstone = false;
+            uint32_t generation = 0;
 
-            std::vector<EntityID> childEntities;
+            // Hierarchy links, children are a list through their sibling links (RootEntityID when there is no entity)
             EntityID parentEntity = RootEntityID;
+            EntityID firstChildEntity = RootEntityID;
+            EntityID lastChildEntity = RootEntityID;
+            EntityID previousSiblingEntity = RootEntityID;
+            EntityID nextSiblingEntity = RootEntityID;
+            // The tick the entity was last given a new parent or taken from its parent
+            uint32_t parentChangeTick = 0;
         };
 
-        using RemoveComponentTypeFunc = void (*)(ECS &ecs);
-        using PruneComponentListFunc = void (*)(ECS &ecs);
-        using ClearComponentListFunc = void (*)(ECS &ecs);
+        using MoveComponentFunc = void (*)(void *destination, void *source);
+        using DestroyComponentFunc = void (*)(void *component);
+        using CopyComponentFunc = void (*)(void *destination, const void *source);
 
         struct ComponentType {
-            void* arrayLocation;
-            std::vector<EntityID> entitiesUsingThis;
-            std::vector<std::size_t> tombstoneComponents;
+            bool isRegistered = false;
+            bool isTrivial;
+            bool isStable;
+            std::size_t size;
+            std::size_t alignment;
 
             InitialiseFunc initialiseFunc;
             DeinitializeFunc deinitializeFunc;
             SerializeFunc serializeFunc;
             DeserializeFunc deserializeFunc;
-            
-            RemoveComponentTypeFunc removeComponentTypeFunc;
-            PruneComponentListFunc pruneComponentListFunc;
-            ClearComponentListFunc clearComponentListFunc;
+
+            MoveComponentFunc moveComponentFunc;
+            DestroyComponentFunc destroyComponentFunc;
+            // Null if the component can't be copied
+            CopyComponentFunc copyComponentFunc;
 
             std::string name;
         };
         struct ComponentManager{
-            std::unordered_map<TypeID, ComponentType> componentTypes;
+            std::vector<ComponentType> componentTypes;
             std::unordered_map<std::string, TypeID> typeNamesToTypeIds;
+            // Indexed by TypeID, only stable component types have a pool
+            std::vector<std::unique_ptr<ChunkPool>> stablePools;
+        };
+
+        // A column holds one component type for every row of an archetype. Shared columns hold
+        // the EntityID of the entity that owns the component instead of the component itself and stable
+        // columns hold a pointer to the component in the pool of its type.
+        struct ArchetypeColumn {
+            TypeID typeId;
+            bool isShared;
+            bool isStable;
+            std::size_t size;
+            std::size_t alignment;
+            std::size_t offset;
+            // Every column is followed by the ComponentTicks of its rows
+            std::size_t tickOffset;
+
+            MoveComponentFunc moveComponentFunc;
+            DestroyComponentFunc destroyComponentFunc;
+        };
+        // Bit masks indexed by TypeID, shared components are set in both masks
+        struct ArchetypeSignature {
+            ComponentSignature components;
+            ComponentSignature sharedComponents;
+            // Archetypes of the entities that hold shared values, they aren't iterated by queries
+            bool isSharedValue = false;
+
+            bool operator==(const ArchetypeSignature &other) const {
+                return components == other.components && sharedComponents == other.sharedComponents && isSharedValue == other.isSharedValue;
+            }
+        };
+        struct ArchetypeSignatureHash {
+            std::size_t operator()(const ArchetypeSignature &signature) const {
+                std::hash<ComponentSignature> hash;
+                return hash(signature.components) ^ (hash(signature.sharedComponents) * 31) ^ signature.isSharedValue;
+            }
+        };
+
+        // The latest changed tick of a column's rows in one chunk, raised from any thread that writes a component
+        struct ChunkChangeTick {
+            std::atomic<uint32_t> tick{0};
+
+            ChunkChangeTick() = default;
+            ChunkChangeTick(const ChunkChangeTick &other) : tick(other.tick.load(std::memory_order_relaxed)) {}
+        };
+        // Entities with the same set of components are stored together in fixed size chunks.
+        // Each chunk starts with the entity IDs of its rows followed by one array per column and its ticks.
+        // Rows are kept packed, removing a row moves the last row into its place.
+        struct Archetype {
+            ArchetypeSignature signature;
+            std::vector<ArchetypeColumn> columns;
+            ComponentMap<std::size_t> columnIndexes;
+
+            std::vector<uint8_t*> chunks;
+            std::size_t chunkCapacity;
+            std::size_t chunkBytes;
+            std::size_t chunkAlignment;
+            // The first chunks can be borrowed from a mapped snapshot, they are never freed by the archetype
+            std::size_t borrowedChunkCount = 0;
+            // Indexed by chunk * columns.size() + column, never lower than the changed ticks of the rows so saveDelta skips unchanged chunks
+            std::vector<ChunkChangeTick> chunkChangeTicks;
+
+            std::size_t size = 0;
+            // Changes whenever rows are moved or removed, never reused by another archetype
+            uint64_t version;
+            // Archetypes of a component type that was removed are emptied and kept so archetype indexes stay valid,
+            // they aren't looked up by their signature, matched by queries or reached through edges again
+            bool isRetired = false;
+
+            ComponentMap<std::size_t> addComponentEdges;
+            ComponentMap<std::size_t> addSharedComponentEdges;
+            ComponentMap<std::size_t> removeComponentEdges;
+        };
+        struct MappedSnapshot {
+            void *data;
+            std::size_t size;
+        };
+        struct ArchetypeManager{
+            std::vector<Archetype> archetypes;
+            std::unordered_map<ArchetypeSignature, std::size_t, ArchetypeSignatureHash> signaturesToArchetypes;
+            std::vector<MappedSnapshot> mappedSnapshots;
+            ChunkPool chunkPool{ArchetypeChunkSize, ArchetypeChunkAlignment};
+        };
+        struct ChunkRange {
+            std::size_t archetype;
+            std::size_t chunk;
+            std::size_t begin;
+            std::size_t end;
         };
         struct EntityManager{
             std::vector<Entity> entities;
-            std::vector<EntityID> tombstoneEntities;
+            std::vector<std::size_t> tombstoneEntities;
             std::unordered_map<EntityGUID, EntityID> entityGUIDToEntityID;
 
             EntityID cachedEntity;
         };
+        struct RemovedComponent {
+            EntityID entityID;
+            TypeID typeId;
+            uint32_t tick;
+        };
+        struct RemovedEntity {
+            EntityGUID entityGUID;
+            uint32_t tick;
+        };
+        // Removals are logged in tick order so the ones that were seen can be cleared from the front
+        struct ChangeManager{
+            uint32_t tick = 1;
+            std::vector<RemovedComponent> removedComponents;
+            std::vector<RemovedEntity> removedEntities;
+        };
+        struct HierarchyNode {
+            EntityID entityID;
+            // The index of the parent's node, RootEntityID for roots
+            std::size_t parentNode;
+            // The children of a node are contiguous in the next level
+            std::size_t childBegin;
+            std::size_t childEnd;
+            uint32_t parentChangeTick;
+        };
+        // Every entity with a parent or children in breadth first order, each level is contiguous and
+        // parents come before their children. It is rebuilt when it is used after the hierarchy changed.
+        struct HierarchyManager{
+            std::vector<HierarchyNode> nodes;
+            std::vector<std::size_t> levelOffsets;
+            // The node of each entity by entity index, RootEntityID for entities outside the hierarchy
+            std::vector<std::size_t> entityNodes;
+            uint32_t lastParentChangeTick = 0;
+            bool isDirty = true;
+        };
+        // Shared components point at an owner entity, either an entity that shares its own component or a hidden
+        // shared value entity that only holds the value. Owners count their sharers, a shared value entity is removed
+        // with its last sharer and an entity that loses a component others share gives it to a new shared value entity.
+        struct SharedValues {
+            std::unordered_map<EntityID, std::size_t> sharerCounts;
+            // Shared value entities by the hash of their value, values are taken out before they can be written
+            std::unordered_multimap<std::size_t, EntityID> valueEntities;
+            std::unordered_map<EntityID, std::size_t> valueHashes;
+            // The values are hashed when the type is first shared by value and again after loading a snapshot or delta
+            bool isIndexed = false;
+        };
+        struct SharedComponentManager{
+            // Indexed by TypeID
+            std::vector<SharedValues> sharedValues;
+            // Set by the scheduler while systems that aren't exclusive run, values can't be copied or unindexed then
+            bool isWriteBlocked = false;
+        };
+        // The component types a query's terms match archetypes by, an archetype needs at least one component of each any of group
+        struct QueryFilter {
+            ComponentSignature requiredComponents;
+            ComponentSignature excludedComponents;
+            std::vector<ComponentSignature> anyOfComponents;
+
+            bool operator==(const QueryFilter &other) const {
+                return requiredComponents == other.requiredComponents && excludedComponents == other.excludedComponents && anyOfComponents == other.anyOfComponents;
+            }
+        };
+        struct QueryFilterHash {
+            std::size_t operator()(const QueryFilter &filter) const {
+                std::hash<ComponentSignature> hash;
+                std::size_t result = hash(filter.requiredComponents) ^ (hash(filter.excludedComponents) * 31);
+                for(const ComponentSignature &components : filter.anyOfComponents){
+                    result = result * 31 ^ hash(components);
+                }
+                return result;
+            }
+        };
+        // The archetypes a query filter matches, archetypes are never removed so a new archetype
+        // is added to the queries it matches when it's created and the matches are otherwise kept
+        struct QueryCache {
+            QueryFilter filter;
+            std::vector<std::size_t> archetypes;
+
+            bool isMatch(const ArchetypeSignature &signature) const {
+                if((signature.components & filter.requiredComponents) != filter.requiredComponents || signature.isSharedValue){return false;}
+                if((signature.components & filter.excludedComponents).any()){return false;}
+                for(const ComponentSignature &components : filter.anyOfComponents){
+                    if((signature.components & components).none()){return false;}
+                }
+                return true;
+            }
+        };
+        // Queries are created the first time they are used, which can happen from systems that run at the same time,
+        // so the registry is locked and each cache keeps its address while others are added
+        struct QueryManager{
+            std::shared_mutex mutex;
+            std::vector<std::unique_ptr<QueryCache>> queries;
+            std::unordered_map<QueryFilter, QueryCache*, QueryFilterHash> filtersToQueries;
+        };
+        struct CommandBufferManager{
+            std::mutex mutex;
+            std::vector<std::unique_ptr<CommandBuffer>> commandBuffers;
+            std::unordered_map<std::thread::id, std::size_t> threadsToCommandBuffers;
+            bool isFlushing = false;
+        };
 
     private:
+        template <typename... Ts> friend class Query;
+        friend class Scheduler;
+
         void terminate();
         
         ComponentType* getComponentType(TypeID typeId);
-        Component* getComponent(Entity *entity, TypeID typeId);
         Entity* getEntity(EntityID entityID);
 
-        void removeComponent(EntityID entityID, TypeID typeId);
+        std::size_t getColumnIndex(Archetype *archetype, TypeID typeId);
+        void* getComponent(Entity *entity, TypeID typeId, ComponentTicks **componentTicks = nullptr);
+        EntityID getComponentOwner(EntityID entityID, TypeID typeId);
+        bool hasComponent(Entity *entity, TypeID typeId);
+        std::vector<EntityID> getEntitiesWithComponent(TypeID typeId, bool includeShared);
+        std::size_t countEntitiesWithComponent(TypeID typeId);
+
+        void removeComponent(EntityID entityID, TypeID typeId, bool isReplaced = false);
+        void unlinkEntity(EntityID entityID);
+        void buildHierarchyOrder();
+        template <typename T> void registerComponentType();
 
         void addComponent(EntityID entityID, EntityID parentEntityID, TypeID typeId);
+        void* addComponentStorage(EntityID entityID, TypeID typeId);
+
+        SharedValues& getSharedValues(TypeID typeId);
+        void* addSharedValue(EntityID &valueEntityID, TypeID typeId);
+        bool isSharedValueEntity(EntityID entityID);
+        std::size_t getSharerCount(EntityID ownerEntityID, TypeID typeId);
+        void releaseSharedComponent(EntityID ownerEntityID, TypeID typeId);
+        void giveSharedComponent(EntityID ownerEntityID, TypeID typeId);
+        void unindexSharedValue(EntityID valueEntityID, TypeID typeId);
+        void countSharedComponents();
+        void* getComponentForWrite(EntityID entityID, TypeID typeId, ComponentTicks **componentTicks);
+        void prepareSharedWrite(const ArchetypeColumn *column, EntityID entityID);
+        void checkParallelWrite(const ArchetypeColumn *column);
 
         bool componentTypeExists(TypeID typeId);
 
-        void runAllComponentDeinitializes(ComponentType *componentType, TypeID typeId);
+        void writeSnapshot(SnapshotWriter &writer);
+        void readSnapshot(SnapshotReader &reader);
+        void readSnapshotContents(SnapshotReader &reader);
+        void writeComponentTypes(SnapshotWriter &writer);
+        std::unordered_map<uint64_t, TypeID> readComponentTypes(SnapshotReader &reader);
 
-        void pruneEntities();
-
-        template <typename T> void pruneComponentList();
-        template <typename T> friend void pruneComponentList_(ECS &ecs);
-
-        template <typename T> friend void removeComponentType_(ECS &ecs);
+        void runAllComponentDeinitializes(ComponentType *componentType, TypeID typeId);
 
-        template <typename T> void clearComponentList();
-        template <typename T> friend void clearComponentList_(ECS &ecs);
+        static TypeID nextTypeID();
+        static uint64_t nextArchetypeVersion();
+
+        EntityID createEntity(EntityGUID entityGUID, std::size_t archetypeIndex);
+        std::vector<EntityID> addEntities(std::size_t count, std::size_t archetypeIndex);
+
+        std::size_t getArchetype(const ArchetypeSignature &signature);
+        std::size_t getArchetypeWith(std::size_t archetypeIndex, TypeID typeId, bool isShared);
+        std::size_t getArchetypeWithout(std::size_t archetypeIndex, TypeID typeId);
+        std::size_t addArchetypeRow(Archetype *archetype);
+        void reserveArchetypeRows(Archetype *archetype, std::size_t count);
+        void freeLastArchetypeChunk(Archetype *archetype);
+        void removeArchetypeRow(Archetype *archetype, std::size_t row);
+        void moveEntity(EntityID entityID, std::size_t archetypeIndex);
+        void destroyEntityRow(Entity *entity);
+        void destroyEntities(std::vector<EntityID> entityIDs);
+        void clearWorld();
+        void retireArchetypes(TypeID typeId);
+        void getHierarchySeeds(TypeID sourceTypeId, TypeID targetTypeId, uint32_t sinceTick, std::vector<std::size_t> &dirtyNodes, std::vector<std::size_t> &changedNodes);
+        void clearArchetypes();
+        void* getColumnData(Archetype *archetype, std::size_t columnIndex, std::size_t row);
+        void* getColumnComponentData(Archetype *archetype, std::size_t columnIndex, std::size_t row);
+        void* createColumnComponent(Archetype *archetype, std::size_t columnIndex, std::size_t row);
+        void moveColumnComponent(const ArchetypeColumn &column, void *destination, void *source);
+        void destroyColumnComponent(const ArchetypeColumn &column, void *data);
+        Allocator& getAllocator();
+        EntityID* getRowEntityID(Archetype *archetype, std::size_t row);
+        ComponentTicks* getColumnTicks(Archetype *archetype, std::size_t columnIndex, std::size_t row);
+        void stampColumn(Archetype *archetype, std::size_t columnIndex, std::size_t row);
+        void setColumnChanged(Archetype *archetype, std::size_t columnIndex, std::size_t row, uint32_t tick);
+        void markComponentChanged(Entity *entity, TypeID typeId, uint32_t tick);
+        std::size_t getChunkChangeTickIndex(Archetype *archetype, std::size_t columnIndex, std::size_t row);
+        void raiseChunkChangeTick(Archetype *archetype, std::size_t changeTickIndex, uint32_t tick);
+        void resizeChunkChangeTicks(Archetype *archetype);
+        void updateChunkChangeTicks(Archetype *archetype);
+        template <typename Func> void forEachArchetypeRow(Archetype &archetype, Func routine);
+        template <typename Func> void forEachArchetypeChunk(Archetype &archetype, Func routine);
+        template <typename Func> void forEachRowRange(Archetype &archetype, std::size_t firstRow, std::size_t rowCount, Func routine);
+        template <typename... Ts> QueryCache* getQuery();
+        QueryCache* getQuery(const QueryFilter &filter);
+        std::size_t countQueryEntities(const QueryCache &query);
+        template <typename... Ts, typename Func, std::size_t... Is> void forEachInArchetypes(Func &routine, const QueryCache &query, uint32_t sinceTick, std::index_sequence<Is...>);
+        template <typename... Ts, typename Func, std::size_t... Is> void parallelForEachInArchetypes(Func &routine, const QueryCache &query, uint32_t sinceTick, std::size_t grainSize, std::index_sequence<Is...>);
+        template <typename T> const ArchetypeColumn* getQueryColumn(Archetype &archetype);
+        template <typename... Ts, std::size_t... Is> void markQueryChunkChanged(Archetype &archetype, const ArchetypeColumn *const *columns, std::size_t row, std::index_sequence<Is...>);
+        template <typename... Ts, typename Func, std::size_t... Is> void forEachInChunk(Func &routine, const ArchetypeColumn *const *columns, uint8_t *chunk, std::size_t begin, std::size_t end, uint32_t sinceTick, std::index_sequence<Is...>);
+        template <typename T> auto getQueryArguments(const ArchetypeColumn *column, uint8_t *chunk, std::size_t chunkRow);
+        template <typename T> T& getColumnComponent(const ArchetypeColumn &column, uint8_t *chunk, std::size_t chunkRow);
+        ComponentTicks getColumnComponentTicks(const ArchetypeColumn &column, uint8_t *chunk, std::size_t chunkRow);
 
     private:
         EntityManager entityManager;
         ComponentManager componentManager;
+        ArchetypeManager archetypeManager;
+        ChangeManager changeManager;
+        HierarchyManager hierarchyManager;
+        SharedComponentManager sharedComponentManager;
+        QueryManager queryManager;
+        CommandBufferManager commandBufferManager;
+        JobSystem *jobSystem = nullptr;
+        Allocator *allocator = nullptr;
     };
 }
 
-#include "ecs.tpp"
\ No newline at end of file
+#include "ecs.tpp"
+#include <commandBuffer.hpp>
+#include <query.hpp>
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <ecs.hpp>
+
+namespace BasicECS{
+
+    /**
+     * @brief A query that keeps the archetypes it matches, archetypes are matched once when the query or the archetype is created
+     * so iterating it doesn't look for matching archetypes. Create it with ECS::createQuery, it must not outlive its ecs
+     * @tparam Ts Component types or Added<T>, Changed<T>, Without<T>, Optional<T> and AnyOf<Ts...> terms, like ECS::forEach
+     */
+    template <typename... Ts> class Query{
+    public:
+        /**
+         * @brief Iterates over all the entities the query matches
+         * @param routine The function for each iteration (function parameters: Ts &...components or Ts &...components, EntityID entityID)
+         */
+        template <typename Func> void forEach(Func &&routine);
+        /**
+         * @brief Iterates over the entities the query matches whose Added and Changed terms changed after a tick
+         * @param sinceTick The tick the caller last iterated at, usually the tick returned by advanceChangeTick
+         * @param routine The function for each iteration (function parameters: Ts &...components or Ts &...components, EntityID entityID, with T in place of the terms)
+         */
+        template <typename Func> void forEach(uint32_t sinceTick, Func &&routine);
+        /**
+         * @brief Iterates over all the entities the query matches on the threads of the job system
+         * @param routine The function for each iteration, called from many threads at once (function parameters: Ts &...components or Ts &...components, EntityID entityID)
+         * @param grainSize The number of entities in each job
+         */
+        template <typename Func> void parallelForEach(Func &&routine, std::size_t grainSize = DefaultGrainSize);
+        /**
+         * @brief Iterates over the entities the query matches whose Added and Changed terms changed after a tick on the threads of the job system
+         * @param sinceTick The tick the caller last iterated at, usually the tick returned by advanceChangeTick
+         * @param routine The function for each iteration, called from many threads at once (function parameters: Ts &...components or Ts &...components, EntityID entityID, with T in place of the terms)
+         * @param grainSize The number of entities in each job, jobs are split before the rows are filtered
+         */
+        template <typename Func> void parallelForEach(uint32_t sinceTick, Func &&routine, std::size_t grainSize = DefaultGrainSize);
+
+        /**
+         * @brief Counts the entities the query matches, Added and Changed terms aren't checked
+         * @return The number of entities
+         */
+        std::size_t count();
+
+    private:
+        friend class ECS;
+
+        Query(ECS &ecs, ECS::QueryCache *query);
+
+    private:
+        ECS *ecs;
+        ECS::QueryCache *query;
+    };
+}
+
+#include "query.tpp"
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <ecs.hpp>
+
+#include <string>
+#include <vector>
+#include <functional>
+
+namespace BasicECS{
+
+    /**
+     * @brief The component types a system reads, the system must read them through const terms (forEach<const T>, getComponent<const T>)
+     * since non const access marks their change ticks while other systems that read them run at the same time
+     */
+    template <typename... Ts> struct Reads {};
+    /**
+     * @brief The component types a system reads and writes
+     */
+    template <typename... Ts> struct Writes {};
+
+    using SystemID = std::size_t;
+    using SystemFunc = std::function<void(ECS &ecs)>;
+    using ChangeSystemFunc = std::function<void(ECS &ecs, uint32_t lastRunTick)>;
+
+    class Scheduler{
+    public:
+        /**
+         * @brief Creates a scheduler for the systems of an ecs
+         * @param ecs The ecs the systems run on
+         */
+        Scheduler(ECS &ecs);
+
+        /**
+         * @brief Adds a system, it runs after the earlier systems whose component access conflicts with it.
+         * Writing a shared value throws in these systems since it can copy the value, use an exclusive system for it
+         * @tparam ReadList The components the system reads (Reads<T...>)
+         * @tparam WriteList The components the system writes (Writes<T...>)
+         * @param name The name of the system 
+         * @param routine The function of the system (function parameters: ECS &ecs)
+         * @return The ID of the system 
+         */
+        template <typename ReadList = Reads<>, typename WriteList = Writes<>> SystemID addSystem(std::string name, SystemFunc routine);
+        /**
+         * @brief Adds a system that only handles changes, it gets the tick it last ran at to use with Added, Changed and forEachRemoved
+         * @tparam ReadList The components the system reads (Reads<T...>), including the ones it filters by
+         * @tparam WriteList The components the system writes (Writes<T...>)
+         * @param name The name of the system 
+         * @param routine The function of the system (function parameters: ECS &ecs, uint32_t lastRunTick), lastRunTick is 0 the first time
+         * @return The ID of the system 
+         */
+        template <typename ReadList = Reads<>, typename WriteList = Writes<>> SystemID addSystem(std::string name, ChangeSystemFunc routine);
+        /**
+         * @brief Adds a system that runs alone, use it for systems that add or remove entities and components
+         * @param name The name of the system 
+         * @param routine The function of the system (function parameters: ECS &ecs)
+         * @return The ID of the system 
+         */
+        SystemID addExclusiveSystem(std::string name, SystemFunc routine);
+        /**
+         * @brief Adds a system that runs alone and only handles changes
+         * @param name The name of the system 
+         * @param routine The function of the system (function parameters: ECS &ecs, uint32_t lastRunTick), lastRunTick is 0 the first time
+         * @return The ID of the system 
+         */
+        SystemID addExclusiveSystem(std::string name, ChangeSystemFunc routine);
+
+        /**
+         * @brief Runs every system once, systems that don't conflict run at the same time on the ecs' job system.
+         * Each batch of systems runs at its own change tick, so a system sees the changes of every system that ran since it last did
+         */
+        void runSystems();
+
+        /**
+         * @brief Gets the groups of systems that run at the same time, in the order they run
+         * @return A list of system ID lists
+         */
+        std::vector<std::vector<SystemID>> getSystemBatches();
+
+    private:
+        struct System {
+            std::string name;
+            ChangeSystemFunc routine;
+            ComponentSignature reads;
+            ComponentSignature writes;
+            bool isExclusive;
+            uint32_t lastRunTick = 0;
+        };
+
+        template <typename... Ts> static ComponentSignature getSignature(Reads<Ts...>);
+        template <typename... Ts> static ComponentSignature getSignature(Writes<Ts...>);
+
+        SystemID addSystem(System system);
+        bool conflicts(const System &system1, const System &system2);
+        void buildBatches();
+
+    private:
+        ECS &ecs;
+        std::vector<System> systems;
+        std::vector<std::vector<SystemID>> batches;
+        bool isBatchesDirty = true;
+    };
+}
+
+#include "scheduler.tpp"
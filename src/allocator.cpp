@@ -0,0 +1,102 @@
+#include "allocator.hpp"
+
+#include <iostream>
+#include <new>
+
+namespace BasicECS{
+
+    class HeapAllocator : public Allocator{
+    public:
+        void* allocate(std::size_t size, std::size_t alignment) override{
+            return ::operator new(size, std::align_val_t(alignment));
+        }
+        void deallocate(void *memory, std::size_t size, std::size_t alignment) override{
+            ::operator delete(memory, std::align_val_t(alignment));
+        }
+    };
+
+    Allocator& Allocator::getDefault(){
+        static HeapAllocator s_DefaultAllocator;
+        return s_DefaultAllocator;
+    }
+
+    ChunkPool::ChunkPool(std::size_t chunkSize, std::size_t chunkAlignment, std::size_t pageChunks) : 
+        allocator(&Allocator::getDefault()), chunkSize(chunkSize), chunkAlignment(chunkAlignment), pageChunks(pageChunks){}
+
+    ChunkPool::~ChunkPool(){
+        release();
+    }
+
+    void ChunkPool::setAllocator(Allocator &allocator){
+        if(usedChunkCount > 0 || !largeAllocations.empty()){
+            std::cerr << "ERROR: can't change the allocator of a pool with chunks in use\n";
+            throw std::exception();
+        }
+
+        release();
+        this->allocator = &allocator;
+    }
+
+    bool ChunkPool::isPooled(std::size_t size, std::size_t alignment){
+        return size <= chunkSize && alignment <= chunkAlignment;
+    }
+
+    void* ChunkPool::allocate(std::size_t size, std::size_t alignment){
+        if(!isPooled(size, alignment)){
+            void *memory = allocator->allocate(size, alignment);
+            largeAllocations.emplace(memory, LargeAllocation{size, alignment});
+            return memory;
+        }
+
+        usedChunkCount++;
+
+        if(!freeChunks.empty()){
+            void *chunk = freeChunks.back();
+            freeChunks.pop_back();
+            return chunk;
+        }
+
+        if(nextChunk == pages.size() * pageChunks){
+            pages.push_back(static_cast<uint8_t*>(allocator->allocate(chunkSize * pageChunks, chunkAlignment)));
+        }
+
+        void *chunk = pages[nextChunk / pageChunks] + (nextChunk % pageChunks) * chunkSize;
+        nextChunk++;
+        return chunk;
+    }
+
+    void ChunkPool::deallocate(void *chunk, std::size_t size, std::size_t alignment){
+        if(isPooled(size, alignment)){
+            freeChunks.push_back(chunk);
+            usedChunkCount--;
+            return;
+        }
+
+        if(largeAllocations.erase(chunk) == 0){
+            std::cerr << "ERROR: can't deallocate memory that wasn't allocated by the pool\n";
+            throw std::exception();
+        }
+
+        allocator->deallocate(chunk, size, alignment);
+    }
+
+    void ChunkPool::reset(){
+        for(const auto &[memory, allocation] : largeAllocations){
+            allocator->deallocate(memory, allocation.size, allocation.alignment);
+        }
+        largeAllocations.clear();
+
+        freeChunks.clear();
+        nextChunk = 0;
+        usedChunkCount = 0;
+    }
+
+    void ChunkPool::release(){
+        reset();
+
+        for(uint8_t *page : pages){
+            allocator->deallocate(page, chunkSize * pageChunks, chunkAlignment);
+        }
+        pages.clear();
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+
+namespace BasicECS{
+
+    constexpr std::size_t ChunkPoolPageChunks = 64;
+
+    class Allocator{
+    public:
+        virtual ~Allocator() = default;
+
+        /**
+         * @brief Allocates memory, throws if the memory can't be allocated
+         * @param size The number of bytes to allocate
+         * @param alignment The alignment of the memory (a power of two)
+         * @return A pointer to the memory
+         */
+        virtual void* allocate(std::size_t size, std::size_t alignment) = 0;
+        /**
+         * @brief Frees memory from allocate
+         * @param memory The pointer allocate returned
+         * @param size The size it was allocated with
+         * @param alignment The alignment it was allocated with
+         */
+        virtual void deallocate(void *memory, std::size_t size, std::size_t alignment) = 0;
+
+        /**
+         * @brief Gets the allocator that uses the global heap, used by every ecs that doesn't set its own
+         * @return A reference to the default allocator
+         */
+        static Allocator& getDefault();
+    };
+
+    // Hands out chunks of one size from pages of many chunks. Freed chunks are reused before the pages
+    // grow, bigger allocations go straight to the allocator and everything is freed at once on reset.
+    class ChunkPool{
+    public:
+        /**
+         * @brief Creates an empty pool that uses the default allocator
+         * @param chunkSize The size of the pooled chunks
+         * @param chunkAlignment The alignment of the pooled chunks
+         * @param pageChunks The number of chunks in each page
+         */
+        ChunkPool(std::size_t chunkSize, std::size_t chunkAlignment, std::size_t pageChunks = ChunkPoolPageChunks);
+        /**
+         * @brief Frees the pages and the big allocations
+         */
+        ~ChunkPool();
+
+        ChunkPool(const ChunkPool&) = delete;
+        ChunkPool& operator=(const ChunkPool&) = delete;
+
+        /**
+         * @brief Sets the allocator the pages come from, the pages of an unused pool are freed first
+         * @param allocator The allocator, it must outlive the pool
+         */
+        void setAllocator(Allocator &allocator);
+
+        /**
+         * @brief Allocates a chunk, a pooled one if it fits in the chunk size and alignment
+         * @param size The size of the chunk
+         * @param alignment The alignment of the chunk
+         * @return A pointer to the chunk
+         */
+        void* allocate(std::size_t size, std::size_t alignment);
+        /**
+         * @brief Gives a chunk back to the pool
+         * @param chunk The pointer allocate returned
+         * @param size The size it was allocated with
+         * @param alignment The alignment it was allocated with
+         */
+        void deallocate(void *chunk, std::size_t size, std::size_t alignment);
+
+        /**
+         * @brief Makes every chunk free at once, the pages are kept for reuse
+         */
+        void reset();
+        /**
+         * @brief Makes every chunk free and frees the pages
+         */
+        void release();
+
+    private:
+        struct LargeAllocation {
+            std::size_t size;
+            std::size_t alignment;
+        };
+
+    private:
+        bool isPooled(std::size_t size, std::size_t alignment);
+
+    private:
+        Allocator *allocator;
+        std::size_t chunkSize;
+        std::size_t chunkAlignment;
+        std::size_t pageChunks;
+
+        std::vector<uint8_t*> pages;
+        // Chunks from nextChunk on have never been handed out since the last reset
+        std::size_t nextChunk = 0;
+        std::vector<void*> freeChunks;
+        std::size_t usedChunkCount = 0;
+        // Keyed by the allocation so large blocks are found in constant time when freed
+        std::unordered_map<void*, LargeAllocation> largeAllocations;
+    };
+}
@@ -0,0 +1,91 @@
+#include "commandBuffer.hpp"
+
+#include <new>
+#include <algorithm>
+#include <cstddef>
+
+namespace BasicECS{
+
+    CommandBuffer::CommandBuffer(){}
+
+    CommandBuffer::~CommandBuffer(){
+        clear();
+
+        for(Block &block : blocks){
+            ::operator delete(block.data, std::align_val_t(block.alignment));
+        }
+    }
+
+    CommandBuffer& CommandBuffer::addEntity(){
+        cachedEntity = newEntityCount;
+        isCachedEntityNew = true;
+        newEntityCount++;
+
+        return *this;
+    }
+
+    CommandBuffer& CommandBuffer::removeEntity(EntityID entityID){
+        addCommand(CommandType::RemoveEntity, entityID, false, 0);
+        return *this;
+    }
+
+    bool CommandBuffer::isEmpty(){
+        return commands.empty() && newEntityCount == 0;
+    }
+
+    void CommandBuffer::clear(){
+        for(Command &command : commands){
+            if(command.destroyComponentFunc != nullptr){
+                command.destroyComponentFunc(command.component);
+            }
+        }
+
+        commands.clear();
+        newEntityCount = 0;
+        isCachedEntityNew = false;
+        currentBlock = 0;
+        blockOffset = 0;
+    }
+
+    void CommandBuffer::addCommand(CommandType type, EntityID entityID, bool isNewEntity, TypeID typeId){
+        commands.push_back({
+            .type = type,
+            .entityID = entityID,
+            .isNewEntity = isNewEntity,
+            .typeId = typeId,
+            .component = nullptr,
+            .addComponentFunc = nullptr,
+            .destroyComponentFunc = nullptr
+        });
+
+        if(type == CommandType::AddComponent){
+            cachedEntity = entityID;
+            isCachedEntityNew = isNewEntity;
+        }
+    }
+
+    void* CommandBuffer::allocateComponent(std::size_t size, std::size_t alignment){
+        while(currentBlock < blocks.size()){
+            Block &block = blocks.at(currentBlock);
+            std::size_t offset = (blockOffset + alignment - 1) / alignment * alignment;
+
+            if(alignment <= block.alignment && offset + size <= block.size){
+                blockOffset = offset + size;
+                return block.data + offset;
+            }
+
+            currentBlock++;
+            blockOffset = 0;
+        }
+
+        Block block;
+        block.size = std::max(size, CommandBufferBlockSize);
+        block.alignment = std::max(alignment, alignof(std::max_align_t));
+        block.data = static_cast<uint8_t*>(::operator new(block.size, std::align_val_t(block.alignment)));
+        blocks.push_back(block);
+
+        currentBlock = blocks.size() - 1;
+        blockOffset = size;
+        return block.data;
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "commandBuffer.hpp"
+
+namespace BasicECS{
+    template <typename T> static void addCommandComponent_(ECS &ecs, EntityID entityID, void *component){
+        ecs.addComponent(entityID, std::move(*static_cast<T*>(component)));
+    }
+
+    template <typename T> static void destroyCommandComponent_(void *component){
+        static_cast<T*>(component)->~T();
+    }
+
+    template <typename T> CommandBuffer& CommandBuffer::addComponent(EntityID entityID, T component){
+        void *storage = allocateComponent(sizeof(T), alignof(T));
+        new (storage) T(std::move(component));
+
+        addCommand(CommandType::AddComponent, entityID, false, ECS::getTypeID<T>());
+        commands.back().component = storage;
+        commands.back().addComponentFunc = addCommandComponent_<T>;
+        commands.back().destroyComponentFunc = destroyCommandComponent_<T>;
+
+        return *this;
+    }
+    template <typename T> CommandBuffer& CommandBuffer::addComponent(T component){
+        void *storage = allocateComponent(sizeof(T), alignof(T));
+        new (storage) T(std::move(component));
+
+        addCommand(CommandType::AddComponent, cachedEntity, isCachedEntityNew, ECS::getTypeID<T>());
+        commands.back().component = storage;
+        commands.back().addComponentFunc = addCommandComponent_<T>;
+        commands.back().destroyComponentFunc = destroyCommandComponent_<T>;
+
+        return *this;
+    }
+
+    template <typename T> CommandBuffer& CommandBuffer::removeComponent(EntityID entityID){
+        addCommand(CommandType::RemoveComponent, entityID, false, ECS::getTypeID<T>());
+        return *this;
+    }
+}
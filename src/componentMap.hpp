@@ -4,14 +4,12 @@
 #include <vector>
 #include <functional>
 
+// Open addressing map keyed by small dense integers (component indexes).
+// The first InlineCapacity slots live inside the map so small maps never allocate.
 template<typename ValueType>
 class ComponentMap { 
 public:
-    ComponentMap() : capacity(5), size(0), loadFactor(0.75){
-        table.resize(capacity);
-    }
-
-    void insert(std::size_t key, ValueType type);
+    void insert(std::size_t key, ValueType value);
 
     void erase(std::size_t key);
 
@@ -19,16 +17,25 @@ public:
 
     void forEach(std::function<void(std::size_t key, ValueType value)> routine);
 
-public: 
+    std::size_t size();
+
+private: 
+    struct Slot {
+        std::size_t key;
+        ValueType value;
+        bool isUsed = false;
+    };
+
+    static constexpr std::size_t InlineCapacity = 8;
+
+    Slot* slots();
     void resize(std::size_t newCapacity);
     std::size_t hash(std::size_t key);
 
-    std::size_t capacity;
-    std::size_t size;
-    float loadFactor;
-    std::vector<std::tuple<std::size_t, ValueType, std::uint16_t>> table;
-
-    std::unordered_map<std::size_t, ValueType> map;
+    std::size_t capacity = InlineCapacity;
+    std::size_t count = 0;
+    Slot inlineTable[InlineCapacity];
+    std::vector<Slot> table;
 };
 
-#include "componentMap.tpp"
\ No newline at end of file
+#include "componentMap.tpp"
@@ -2,54 +2,87 @@
 #include <random>
 #include <iostream>
 #include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <atomic>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
 
 namespace BasicECS{
 
+    static std::size_t getEntityIndex(EntityID entityID){
+        return entityID & EntityIndexMask;
+    }
+
+    static EntityID createEntityID(std::size_t index, uint32_t generation){
+        return (static_cast<EntityID>(generation) << EntityIndexBits) | index;
+    }
+
+    ECS::ECS(){
+        // Archetype 0 is always the archetype of entities without components
+        getArchetype(ArchetypeSignature{});
+    }
+
     ECS::~ECS(){
         terminate();
     }
 
     void ECS::terminate(){
-        for (auto& componentType : componentManager.componentTypes) {
-            componentType.second.removeComponentTypeFunc(*this);
-        }
+        clear();
     }
 
     void ECS::clear(){
-        for (auto& componentType : componentManager.componentTypes) {
-            runAllComponentDeinitializes(&componentType.second, componentType.first);
+        {
+            std::lock_guard<std::mutex> lock(commandBufferManager.mutex);
+            for(std::unique_ptr<CommandBuffer> &commandBuffer : commandBufferManager.commandBuffers){
+                commandBuffer->clear();
+            }
         }
-        for (auto& componentType : componentManager.componentTypes) {
-            componentType.second.clearComponentListFunc(*this);
+
+        for (TypeID typeId = 0; typeId < componentManager.componentTypes.size(); typeId++) {
+            if(componentManager.componentTypes[typeId].isRegistered){
+                runAllComponentDeinitializes(&componentManager.componentTypes[typeId], typeId);
+            }
         }
 
+        clearWorld();
+    }
+
+    void ECS::clearWorld(){
+        clearArchetypes();
+
         entityManager.entities.clear();
         entityManager.entityGUIDToEntityID.clear();
         entityManager.tombstoneEntities.clear();
+
+        // The tick is kept so ticks from before the clear stay in the past
+        changeManager.removedComponents.clear();
+        changeManager.removedEntities.clear();
+
+        hierarchyManager.isDirty = true;
+        countSharedComponents();
     }
 
     void ECS::forEachEntity(std::function<void(EntityID &entity)> routine){
-        std::size_t currentNextTombstoneIndex = 0;
-        std::size_t currentNextTombstone = 0;
-        if(!entityManager.tombstoneEntities.empty()){
-            currentNextTombstone = entityManager.tombstoneEntities.at(currentNextTombstoneIndex);
-        }
-
         for(std::size_t i = 0; i < entityManager.entities.size(); i++){
-            if(i == currentNextTombstone && currentNextTombstoneIndex < entityManager.tombstoneEntities.size()){
-                currentNextTombstoneIndex ++;
-                if(currentNextTombstoneIndex < entityManager.tombstoneEntities.size()){
-                    currentNextTombstone = entityManager.tombstoneEntities.at(currentNextTombstoneIndex);
-                }
-            }else{
-                routine(i);
-            }
+            if(entityManager.entities[i].isTombstone){continue;}
+
+            EntityID entityID = createEntityID(i, entityManager.entities[i].generation);
+            routine(entityID);
         }
     }
     void ECS::forEachComponent(EntityID entityID ,std::function<void(TypeID componentTypeID)> routine){
-        getEntity(entityID)->components.forEach([&routine](TypeID componentTypeID, Component value){
-            routine(componentTypeID);
-        });
+        std::vector<ArchetypeColumn> columns = archetypeManager.archetypes.at(getEntity(entityID)->archetype).columns;
+
+        for(std::size_t i = 0; i < columns.size(); i++){
+            routine(columns.at(i).typeId);
+        }
     }
 
     static std::random_device s_RandomDevice;
@@ -69,68 +102,220 @@ namespace BasicECS{
     }
 
     ECS& ECS::addEntity(EntityID &entityID, EntityGUID entityGUID){
-        Entity entity{.entityGUID = entityGUID};
+        entityID = createEntity(entityGUID, 0);
+
+        entityManager.cachedEntity = entityID;
+
+        return *this;
+    }
+
+    EntityID ECS::createEntity(EntityGUID entityGUID, std::size_t archetypeIndex){
+        if(entityManager.entityGUIDToEntityID.find(entityGUID) != entityManager.entityGUIDToEntityID.end()){
+            std::cerr << "ERROR: entityGUID  '" << entityGUID << "' already exists\n";
+            throw std::exception();
+        }
+
+        Entity entity{.archetype = archetypeIndex, .entityGUID = entityGUID};
+        std::size_t index;
 
+        // Reused indexes keep the generation they were given when they were removed
         if(!entityManager.tombstoneEntities.empty()){
-            entityID = entityManager.tombstoneEntities.back();
+            index = entityManager.tombstoneEntities.back();
             entityManager.tombstoneEntities.pop_back();
-            entityManager.entities[entityID] = entity;
+            entity.generation = entityManager.entities[index].generation;
+            entityManager.entities[index] = entity;
         }else{
             entityManager.entities.push_back(entity);
-            entityID = entityManager.entities.size() - 1;
+            index = entityManager.entities.size() - 1;
         }
+        EntityID entityID = createEntityID(index, entity.generation);
+
+        Archetype *archetype = &archetypeManager.archetypes.at(archetypeIndex);
+        entityManager.entities[index].archetypeRow = addArchetypeRow(archetype);
+        *getRowEntityID(archetype, entityManager.entities[index].archetypeRow) = entityID;
 
-        if(entityManager.entityGUIDToEntityID.find(entityGUID) != entityManager.entityGUIDToEntityID.end()){
-            std::cerr << "ERROR: entityGUID  '" << entityGUID << "' already exists\n";
-            throw std::exception();
-        }
         entityManager.entityGUIDToEntityID[entityGUID] = entityID;
 
-        entityManager.cachedEntity = entityID;
+        return entityID;
+    }
 
-        return *this;
+    std::vector<EntityID> ECS::addEntities(std::size_t count, std::size_t archetypeIndex){
+        std::size_t reusedCount = std::min(count, entityManager.tombstoneEntities.size());
+        entityManager.entities.reserve(entityManager.entities.size() + count - reusedCount);
+        entityManager.entityGUIDToEntityID.reserve(entityManager.entityGUIDToEntityID.size() + count);
+        reserveArchetypeRows(&archetypeManager.archetypes.at(archetypeIndex), count);
+
+        std::vector<EntityID> entityIDs(count);
+        for(std::size_t i = 0; i < count; i++){
+            entityIDs[i] = createEntity(s_UniformDistribution(s_Engine), archetypeIndex);
+        }
+
+        if(count > 0){
+            entityManager.cachedEntity = entityIDs.back();
+        }
+
+        return entityIDs;
     }
 
     ECS& ECS::removeEntity(EntityID entityID){
-        Entity *entity = getEntity(entityID);
+        getEntity(entityID);
+        destroyEntities({entityID});
+        return *this;
+    }
+    ECS& ECS::removeEntities(const std::vector<EntityID> &entityIDs){
+        for(EntityID entityID : entityIDs){
+            getEntity(entityID);
+        }
+        destroyEntities(entityIDs);
+        return *this;
+    }
 
-        std::vector<TypeID> componentsToDelete;
+    void ECS::destroyEntities(std::vector<EntityID> entityIDs){
+        std::sort(entityIDs.begin(), entityIDs.end());
+        entityIDs.erase(std::unique(entityIDs.begin(), entityIDs.end()), entityIDs.end());
 
-        entity->components.forEach([&componentsToDelete](std::size_t key, Component value){
-            componentsToDelete.push_back(key);
-        });
+        std::size_t rootCount = entityIDs.size();
 
-        for(std::size_t i = 0; i < componentsToDelete.size(); i++){
-            removeComponent(entityID, componentsToDelete.at(i));
+        // Detached subtrees can't overlap so each entity is collected once
+        for(EntityID entityID : entityIDs){
+            unlinkEntity(entityID);
         }
 
-        auto pos = std::lower_bound(entityManager.tombstoneEntities.begin(), entityManager.tombstoneEntities.end(), entityID);
-        entityManager.tombstoneEntities.insert(pos, entityID);
+        // The subtrees are collected breadth first without recursion
+        for(std::size_t i = 0; i < entityIDs.size(); i++){
+            EntityID childEntityID = entityManager.entities[getEntityIndex(entityIDs[i])].firstChildEntity;
+            while(childEntityID != RootEntityID){
+                entityIDs.push_back(childEntityID);
+                childEntityID = entityManager.entities[getEntityIndex(childEntityID)].nextSiblingEntity;
+            }
+        }
+
+        // Entities of the same archetype are next to each other so each component type is deinitialized in one run
+        std::stable_sort(entityIDs.begin(), entityIDs.end(), [this](EntityID a, EntityID b){
+            return entityManager.entities[getEntityIndex(a)].archetype < entityManager.entities[getEntityIndex(b)].archetype;
+        });
+
+        std::size_t runBegin = 0;
+        while(runBegin < entityIDs.size()){
+            std::size_t archetypeIndex = entityManager.entities[getEntityIndex(entityIDs[runBegin])].archetype;
+            std::size_t runEnd = runBegin + 1;
+            while(runEnd < entityIDs.size() && entityManager.entities[getEntityIndex(entityIDs[runEnd])].archetype == archetypeIndex){
+                runEnd++;
+            }
+
+            // Deinitialize functions can add archetypes so the columns are copied
+            std::vector<ArchetypeColumn> columns = archetypeManager.archetypes.at(archetypeIndex).columns;
+            bool isSharedValue = archetypeManager.archetypes.at(archetypeIndex).signature.isSharedValue;
+            for(const ArchetypeColumn &column : columns){
+                ComponentType *componentType = getComponentType(column.typeId);
+                if(column.isShared){continue;}
+
+                bool hasSharers = !sharedComponentManager.sharedValues.empty() && !sharedComponentManager.sharedValues[column.typeId].sharerCounts.empty();
+                if(!hasSharers && componentType->deinitializeFunc == nullptr){continue;}
+
+                for(std::size_t i = runBegin; i < runEnd; i++){
+                    if(!isEntityValid(entityIDs[i])){continue;}
+
+                    // The sharers keep the component, it's deinitialized when the last of them loses it
+                    if(hasSharers && getSharerCount(entityIDs[i], column.typeId) > 0){
+                        giveSharedComponent(entityIDs[i], column.typeId);
+                    }else if(componentType->deinitializeFunc != nullptr){
+                        componentType->deinitializeFunc(*this, entityIDs[i]);
+                    }
+                }
+            }
+
+            // Shared value entities are hidden so only their removal is logged
+            if(isSharedValue){
+                runBegin = runEnd;
+                continue;
+            }
+
+            changeManager.removedComponents.reserve(changeManager.removedComponents.size() + (runEnd - runBegin) * columns.size());
+            for(std::size_t i = runBegin; i < runEnd; i++){
+                for(const ArchetypeColumn &column : columns){
+                    changeManager.removedComponents.push_back({entityIDs[i], column.typeId, changeManager.tick});
+                }
+            }
 
-        for(std::size_t i = 0; i < entity->childEntities.size(); i++){
-            removeEntity(entity->childEntities.at(i));
+            runBegin = runEnd;
         }
 
-        if(entity->parentEntity != RootEntityID){
-            Entity *parentEntity = getEntity(entity->parentEntity);
+        changeManager.removedEntities.reserve(changeManager.removedEntities.size() + entityIDs.size());
+        entityManager.tombstoneEntities.reserve(entityManager.tombstoneEntities.size() + entityIDs.size());
+
+        std::vector<std::pair<EntityID, TypeID>> sharedComponents;
+
+        for(EntityID entityID : entityIDs){
+            // A deinitialize function may have removed the entity already
+            if(!isEntityValid(entityID)){continue;}
 
-            std::vector<EntityID> vec = parentEntity->childEntities;
-            vec.erase(std::remove(vec.begin(), vec.end(), entityID), vec.end());
+            Entity *entity = &entityManager.entities[getEntityIndex(entityID)];
+            changeManager.removedEntities.push_back({entity->entityGUID, changeManager.tick});
+
+            Archetype *archetype = &archetypeManager.archetypes[entity->archetype];
+            if(archetype->signature.sharedComponents.any()){
+                for(std::size_t i = 0; i < archetype->columns.size(); i++){
+                    if(archetype->columns[i].isShared){
+                        sharedComponents.push_back({*static_cast<EntityID*>(getColumnData(archetype, i, entity->archetypeRow)), archetype->columns[i].typeId});
+                    }
+                }
+            }
+
+            destroyEntityRow(entity);
+
+            entityManager.entityGUIDToEntityID.erase(entity->entityGUID);
+            entityManager.tombstoneEntities.push_back(getEntityIndex(entityID));
+
+            // The whole subtree goes so the links inside it are dropped instead of unlinked
+            entity->parentEntity = RootEntityID;
+            entity->firstChildEntity = RootEntityID;
+            entity->lastChildEntity = RootEntityID;
+            entity->previousSiblingEntity = RootEntityID;
+            entity->nextSiblingEntity = RootEntityID;
+
+            entity->isTombstone = true;
+            entity->generation++;
         }
 
-        entity->isTombstone = true;
+        if(entityIDs.size() > rootCount){
+            hierarchyManager.isDirty = true;
+        }
 
-        pruneEntities();
-        
-        return *this;
+        // Released once the rows are gone, the last sharer of a shared value removes its entity
+        for(const auto &[ownerEntityID, typeId] : sharedComponents){
+            releaseSharedComponent(ownerEntityID, typeId);
+        }
     }
 
     ECS& ECS::appendChild(EntityID entityID, EntityID childEntityID){
+        // Only an entity with children can be an ancestor of another entity, so leaves skip the walk up
+        bool isLeaf = getEntity(childEntityID)->firstChildEntity == RootEntityID;
+        for(EntityID ancestorID = entityID; ancestorID != RootEntityID; ancestorID = isLeaf ? RootEntityID : getEntity(ancestorID)->parentEntity){
+            if(ancestorID == childEntityID){
+                std::cerr << "ERROR: can't append entity '" << childEntityID << "' to itself or one of its children\n";
+                throw std::exception();
+            }
+        }
+
+        unlinkEntity(childEntityID);
+
         Entity *entity = getEntity(entityID);
         Entity *childEntity = getEntity(childEntityID);
 
-        entity->childEntities.push_back(childEntityID);
         childEntity->parentEntity = entityID;
+        childEntity->parentChangeTick = changeManager.tick;
+        childEntity->previousSiblingEntity = entity->lastChildEntity;
+        childEntity->nextSiblingEntity = RootEntityID;
+
+        if(entity->lastChildEntity != RootEntityID){
+            getEntity(entity->lastChildEntity)->nextSiblingEntity = childEntityID;
+        }else{
+            entity->firstChildEntity = childEntityID;
+        }
+        entity->lastChildEntity = childEntityID;
+
+        hierarchyManager.isDirty = true;
 
         return *this;
     }
@@ -139,8 +324,79 @@ namespace BasicECS{
         return entity->parentEntity;
     }
     std::vector<EntityID> ECS::getChildEntityIDs(EntityID entityID){
+        std::vector<EntityID> childEntityIDs;
+        forEachChild(entityID, [&childEntityIDs](EntityID childEntityID){
+            childEntityIDs.push_back(childEntityID);
+        });
+        return childEntityIDs;
+    }
+
+    void ECS::unlinkEntity(EntityID entityID){
         Entity *entity = getEntity(entityID);
-        return entity->childEntities;
+        if(entity->parentEntity == RootEntityID){
+            return;
+        }
+
+        Entity *parentEntity = getEntity(entity->parentEntity);
+
+        if(entity->previousSiblingEntity != RootEntityID){
+            getEntity(entity->previousSiblingEntity)->nextSiblingEntity = entity->nextSiblingEntity;
+        }else{
+            parentEntity->firstChildEntity = entity->nextSiblingEntity;
+        }
+        if(entity->nextSiblingEntity != RootEntityID){
+            getEntity(entity->nextSiblingEntity)->previousSiblingEntity = entity->previousSiblingEntity;
+        }else{
+            parentEntity->lastChildEntity = entity->previousSiblingEntity;
+        }
+
+        entity->parentEntity = RootEntityID;
+        entity->parentChangeTick = changeManager.tick;
+        entity->previousSiblingEntity = RootEntityID;
+        entity->nextSiblingEntity = RootEntityID;
+
+        hierarchyManager.isDirty = true;
+    }
+
+    void ECS::buildHierarchyOrder(){
+        std::vector<HierarchyNode> &nodes = hierarchyManager.nodes;
+        nodes.clear();
+        hierarchyManager.levelOffsets.clear();
+        hierarchyManager.entityNodes.assign(entityManager.entities.size(), RootEntityID);
+        hierarchyManager.lastParentChangeTick = 0;
+
+        for(std::size_t i = 0; i < entityManager.entities.size(); i++){
+            const Entity &entity = entityManager.entities[i];
+            if(!entity.isTombstone && entity.parentEntity == RootEntityID && entity.firstChildEntity != RootEntityID){
+                nodes.push_back({createEntityID(i, entity.generation), RootEntityID, 0, 0, entity.parentChangeTick});
+            }
+        }
+
+        // Each level is the children of the level before it
+        std::size_t levelBegin = 0;
+        while(levelBegin < nodes.size()){
+            hierarchyManager.levelOffsets.push_back(levelBegin);
+
+            std::size_t levelEnd = nodes.size();
+            for(std::size_t node = levelBegin; node < levelEnd; node++){
+                std::size_t entityIndex = getEntityIndex(nodes[node].entityID);
+                hierarchyManager.entityNodes[entityIndex] = node;
+                hierarchyManager.lastParentChangeTick = std::max(hierarchyManager.lastParentChangeTick, nodes[node].parentChangeTick);
+
+                nodes[node].childBegin = nodes.size();
+                EntityID childEntityID = entityManager.entities[entityIndex].firstChildEntity;
+                while(childEntityID != RootEntityID){
+                    const Entity &child = entityManager.entities[getEntityIndex(childEntityID)];
+                    nodes.push_back({childEntityID, node, 0, 0, child.parentChangeTick});
+                    childEntityID = child.nextSiblingEntity;
+                }
+                nodes[node].childEnd = nodes.size();
+            }
+            levelBegin = levelEnd;
+        }
+        hierarchyManager.levelOffsets.push_back(nodes.size());
+
+        hierarchyManager.isDirty = false;
     }
 
     EntityGUID ECS::getEntityGUID(EntityID entityID){
@@ -157,186 +413,1917 @@ namespace BasicECS{
         return it->second;
     }
 
-    void ECS::removeComponent(EntityID entityID, TypeID typeId){
+    void ECS::removeComponent(EntityID entityID, TypeID typeId, bool isReplaced){
 
         ComponentType *componentType = getComponentType(typeId);
 
         Entity *entity = getEntity(entityID);
 
-        Component *component = getComponent(entity, typeId);
+        Archetype *archetype = &archetypeManager.archetypes.at(entity->archetype);
 
-        if(component->parent == entityID){
-            std::size_t index = (std::size_t)component->componentIndex;
-            
-            auto pos = std::lower_bound(componentType->tombstoneComponents.begin(), componentType->tombstoneComponents.end(), index);
-            componentType->tombstoneComponents.insert(pos, index);
+        std::size_t columnIndex = getColumnIndex(archetype, typeId);
+        bool isShared = archetype->columns.at(columnIndex).isShared;
+        EntityID ownerEntityID = isShared ? *static_cast<EntityID*>(getColumnData(archetype, columnIndex, entity->archetypeRow)) : entityID;
 
-            if(componentType->deinitializeFunc != nullptr){
+        if(!isShared){
+            // The sharers keep the component, it's deinitialized when the last of them loses it
+            if(!isReplaced && getSharerCount(entityID, typeId) > 0){
+                giveSharedComponent(entityID, typeId);
+            }else if(componentType->deinitializeFunc != nullptr){
                 componentType->deinitializeFunc(*this, entityID);
             }
         }
 
-        entity->components.erase(typeId);
-
-        for(std::size_t i = 0; i < componentType->entitiesUsingThis.size(); i++){
-            if(componentType->entitiesUsingThis.at(i) == entityID){
-                componentType->entitiesUsingThis.erase(componentType->entitiesUsingThis.begin() + i);
-            }
+        // A replaced component is added again straight away so it isn't a removal
+        if(!isReplaced){
+            changeManager.removedComponents.push_back({entityID, typeId, changeManager.tick});
         }
 
-        componentType->pruneComponentListFunc(*this);
+        moveEntity(entityID, getArchetypeWithout(getEntity(entityID)->archetype, typeId));
+
+        if(isShared){
+            releaseSharedComponent(ownerEntityID, typeId);
+        }
     }
 
     void ECS::addComponent(EntityID entityID, EntityID parentEntityID, TypeID typeId){
-        ComponentType *componentType = getComponentType(typeId);
+        getComponentType(typeId);
+
+        EntityID ownerEntityID = getComponentOwner(parentEntityID, typeId);
+        if(ownerEntityID == entityID){
+            std::cerr << "ERROR: entity '" << entityID << "' can't share its own component\n";
+            throw std::exception();
+        }
 
         Entity *entity = getEntity(entityID);
 
-        Entity *parentEntity = getEntity(parentEntityID);
+        entityManager.cachedEntity = entityID;
 
-        Component component = (Component)*getComponent(parentEntity, typeId);
+        // Counted before the old component is removed, it may be shared from the same owner
+        getSharedValues(typeId).sharerCounts[ownerEntityID]++;
 
-        entityManager.cachedEntity = entityID;
+        if(hasComponent(entity, typeId)){
+            removeComponent(entityID, typeId, true);
+        }
+
+        moveEntity(entityID, getArchetypeWith(getEntity(entityID)->archetype, typeId, true));
+
+        entity = getEntity(entityID);
+        Archetype *archetype = &archetypeManager.archetypes.at(entity->archetype);
+        std::size_t columnIndex = getColumnIndex(archetype, typeId);
+
+        EntityID *owner = static_cast<EntityID*>(getColumnData(archetype, columnIndex, entity->archetypeRow));
+        *owner = ownerEntityID;
+        stampColumn(archetype, columnIndex, entity->archetypeRow);
+    }
+
+    ECS::SharedValues& ECS::getSharedValues(TypeID typeId){
+        // Sized once so references stay valid while other types are shared
+        if(sharedComponentManager.sharedValues.empty()){
+            sharedComponentManager.sharedValues.resize(MaxComponentTypes);
+        }
+        return sharedComponentManager.sharedValues[typeId];
+    }
+
+    void* ECS::addSharedValue(EntityID &valueEntityID, TypeID typeId){
+        ArchetypeSignature signature;
+        signature.components.set(typeId);
+        signature.isSharedValue = true;
+
+        // Created in the archetype of the type's values, so copying a value that exists never adds an archetype
+        std::size_t archetypeIndex = getArchetype(signature);
+        valueEntityID = createEntity(s_UniformDistribution(s_Engine), archetypeIndex);
+
+        Archetype *archetype = &archetypeManager.archetypes.at(archetypeIndex);
+        std::size_t columnIndex = getColumnIndex(archetype, typeId);
+        std::size_t row = getEntity(valueEntityID)->archetypeRow;
+
+        stampColumn(archetype, columnIndex, row);
+        return createColumnComponent(archetype, columnIndex, row);
+    }
+
+    bool ECS::isSharedValueEntity(EntityID entityID){
+        return archetypeManager.archetypes[getEntity(entityID)->archetype].signature.isSharedValue;
+    }
+
+    std::size_t ECS::getSharerCount(EntityID ownerEntityID, TypeID typeId){
+        if(sharedComponentManager.sharedValues.empty()){return 0;}
+
+        const std::unordered_map<EntityID, std::size_t> &sharerCounts = sharedComponentManager.sharedValues[typeId].sharerCounts;
+        auto it = sharerCounts.find(ownerEntityID);
+        return it != sharerCounts.end() ? it->second : 0;
+    }
+
+    void ECS::releaseSharedComponent(EntityID ownerEntityID, TypeID typeId){
+        SharedValues &sharedValues = getSharedValues(typeId);
+
+        auto it = sharedValues.sharerCounts.find(ownerEntityID);
+        if(it == sharedValues.sharerCounts.end()){return;}
+        if(--it->second > 0){return;}
+        sharedValues.sharerCounts.erase(it);
+
+        // A shared value entity is only there for its sharers
+        if(isEntityValid(ownerEntityID) && isSharedValueEntity(ownerEntityID)){
+            unindexSharedValue(ownerEntityID, typeId);
+            destroyEntities({ownerEntityID});
+        }
+    }
+
+    void ECS::giveSharedComponent(EntityID ownerEntityID, TypeID typeId){
+        SharedValues &sharedValues = getSharedValues(typeId);
+        ComponentType *componentType = getComponentType(typeId);
+
+        auto forEachSharer = [&](auto routine){
+            for(Archetype &archetype : archetypeManager.archetypes){
+                if(!archetype.signature.sharedComponents.test(typeId)){continue;}
+
+                const ArchetypeColumn &column = archetype.columns[*archetype.columnIndexes.get(typeId)];
+                forEachArchetypeChunk(archetype, [&](uint8_t *chunk, std::size_t rowCount){
+                    EntityID *owners = reinterpret_cast<EntityID*>(chunk + column.offset);
+                    for(std::size_t row = 0; row < rowCount; row++){
+                        if(owners[row] == ownerEntityID){
+                            routine(reinterpret_cast<EntityID*>(chunk)[row], owners[row]);
+                        }
+                    }
+                });
+            }
+        };
+
+        // A component that can't be copied goes with its owner
+        if(componentType->copyComponentFunc == nullptr){
+            std::vector<EntityID> sharingEntities;
+            forEachSharer([&sharingEntities](EntityID sharingEntityID, EntityID &owner){
+                sharingEntities.push_back(sharingEntityID);
+            });
+            for(EntityID sharingEntityID : sharingEntities){
+                removeComponent(sharingEntityID, typeId);
+            }
+            return;
+        }
+
+        EntityID valueEntityID;
+        void *value = addSharedValue(valueEntityID, typeId);
+        componentType->copyComponentFunc(value, getComponent(getEntity(ownerEntityID), typeId));
+
+        forEachSharer([valueEntityID](EntityID sharingEntityID, EntityID &owner){
+            owner = valueEntityID;
+        });
+
+        sharedValues.sharerCounts[valueEntityID] = sharedValues.sharerCounts[ownerEntityID];
+        sharedValues.sharerCounts.erase(ownerEntityID);
+    }
+
+    void ECS::unindexSharedValue(EntityID valueEntityID, TypeID typeId){
+        SharedValues &sharedValues = getSharedValues(typeId);
+
+        auto it = sharedValues.valueHashes.find(valueEntityID);
+        if(it == sharedValues.valueHashes.end()){return;}
+
+        auto range = sharedValues.valueEntities.equal_range(it->second);
+        for(auto valueIt = range.first; valueIt != range.second; valueIt++){
+            if(valueIt->second == valueEntityID){
+                sharedValues.valueEntities.erase(valueIt);
+                break;
+            }
+        }
+        sharedValues.valueHashes.erase(it);
+    }
+
+    void ECS::countSharedComponents(){
+        for(SharedValues &sharedValues : sharedComponentManager.sharedValues){
+            sharedValues = SharedValues{};
+        }
+
+        for(Archetype &archetype : archetypeManager.archetypes){
+            for(const ArchetypeColumn &column : archetype.columns){
+                if(!column.isShared){continue;}
+
+                std::unordered_map<EntityID, std::size_t> &sharerCounts = getSharedValues(column.typeId).sharerCounts;
+                forEachArchetypeChunk(archetype, [&](uint8_t *chunk, std::size_t rowCount){
+                    EntityID *owners = reinterpret_cast<EntityID*>(chunk + column.offset);
+                    for(std::size_t row = 0; row < rowCount; row++){
+                        sharerCounts[owners[row]]++;
+                    }
+                });
+            }
+        }
+    }
+
+    void ECS::prepareSharedWrite(const ArchetypeColumn *column, EntityID entityID){
+        if(column == nullptr || !column->isShared){return;}
+
+        // The shared value entities are in an archetype queries don't match, so copying the value doesn't move the iterated rows
+        ComponentTicks *componentTicks;
+        getComponentForWrite(entityID, column->typeId, &componentTicks);
+    }
 
-        Component *component_it = entity->components.get(typeId);
-        if(component_it != nullptr){
-            removeComponent(entityID, typeId);
+    void ECS::checkParallelWrite(const ArchetypeColumn *column){
+        if(column != nullptr && column->isShared){
+            std::cerr << "ERROR: shared component '" << getComponentType(column->typeId)->name << "' can only be iterated through a const term in parallel\n";
+            throw std::exception();
+        }
+    }
+
+    void* ECS::getComponentForWrite(EntityID entityID, TypeID typeId, ComponentTicks **componentTicks){
+        Entity *entity = getEntity(entityID);
+        Archetype *archetype = &archetypeManager.archetypes.at(entity->archetype);
+        std::size_t columnIndex = getColumnIndex(archetype, typeId);
+
+        if(archetype->columns.at(columnIndex).isShared){
+            EntityID ownerEntityID = *static_cast<EntityID*>(getColumnData(archetype, columnIndex, entity->archetypeRow));
+
+            if(isSharedValueEntity(ownerEntityID)){
+                // Systems writing different shared types would change the shared values and the archetype of the values at the same time
+                if(sharedComponentManager.isWriteBlocked){
+                    std::cerr << "ERROR: shared component '" << getComponentType(typeId)->name << "' can only be written from an exclusive system\n";
+                    throw std::exception();
+                }
+
+                // Copy on write, the other sharers keep the value
+                if(getSharerCount(ownerEntityID, typeId) > 1){
+                    ComponentType *componentType = getComponentType(typeId);
+                    if(componentType->copyComponentFunc == nullptr){
+                        std::cerr << "ERROR: can't write the shared value of '" << componentType->name << "', it can't be copied\n";
+                        throw std::exception();
+                    }
+
+                    EntityID valueEntityID;
+                    void *value = addSharedValue(valueEntityID, typeId);
+                    componentType->copyComponentFunc(value, getComponent(getEntity(ownerEntityID), typeId));
+                    if(componentType->initialiseFunc != nullptr){
+                        componentType->initialiseFunc(*this, valueEntityID);
+                    }
+
+                    entity = getEntity(entityID);
+                    archetype = &archetypeManager.archetypes.at(entity->archetype);
+                    *static_cast<EntityID*>(getColumnData(archetype, columnIndex, entity->archetypeRow)) = valueEntityID;
+                    setColumnChanged(archetype, columnIndex, entity->archetypeRow, changeManager.tick);
+
+                    getSharedValues(typeId).sharerCounts[valueEntityID] = 1;
+                    releaseSharedComponent(ownerEntityID, typeId);
+                }else{
+                    // The value can be written from now on so equal values can't be found by it
+                    unindexSharedValue(ownerEntityID, typeId);
+                }
+            }
         }
 
-        entity->components.insert(typeId, component);
+        markComponentChanged(getEntity(entityID), typeId, changeManager.tick);
+        return getComponent(getEntity(entityID), typeId, componentTicks);
+    }
+
+    void* ECS::addComponentStorage(EntityID entityID, TypeID typeId){
+        getComponentType(typeId);
+
+        moveEntity(entityID, getArchetypeWith(getEntity(entityID)->archetype, typeId, false));
+
+        Entity *entity = getEntity(entityID);
+        Archetype *archetype = &archetypeManager.archetypes.at(entity->archetype);
+        std::size_t columnIndex = getColumnIndex(archetype, typeId);
 
-        componentType->entitiesUsingThis.push_back(entityID);
+        stampColumn(archetype, columnIndex, entity->archetypeRow);
+        return createColumnComponent(archetype, columnIndex, entity->archetypeRow);
     }
 
     bool ECS::componentTypeExists(TypeID typeId){
-        if(componentManager.componentTypes.find(typeId) == componentManager.componentTypes.end()){
+        return typeId < componentManager.componentTypes.size() && componentManager.componentTypes[typeId].isRegistered;
+    }
+
+    bool ECS::isEntityValid(EntityID entityID){
+        std::size_t index = getEntityIndex(entityID);
+        if(index >= entityManager.entities.size()){
             return false;
         }
-        return true;
+
+        const Entity &entity = entityManager.entities[index];
+        return entity.isTombstone == false && createEntityID(index, entity.generation) == entityID;
     }
 
     ECS::ComponentType* ECS::getComponentType(TypeID typeId){
-        auto componentType_it = componentManager.componentTypes.find(typeId);
-        if(componentType_it == componentManager.componentTypes.end()){
+        if(componentTypeExists(typeId) == false){
             std::cerr << "ERROR: component type with id '" << typeId << "' is unknown\n";
             throw std::exception();
         }
-        return &componentType_it->second;
+        return &componentManager.componentTypes[typeId];
     }
 
-    ECS::Component* ECS::getComponent(Entity *entity, TypeID typeId){
-        Component *component = entity->components.get(typeId);
-        if(component == nullptr){
+    std::size_t ECS::getColumnIndex(Archetype *archetype, TypeID typeId){
+        std::size_t *columnIndex = archetype->columnIndexes.get(typeId);
+        if(columnIndex == nullptr){
             ComponentType *componentType = getComponentType(typeId);
             std::cerr << "ERROR: Entity doesn't contain component of type '" << componentType->name << "'\n";
             throw std::exception();
         }
+        return *columnIndex;
+    }
+
+    void* ECS::getComponent(Entity *entity, TypeID typeId, ComponentTicks **componentTicks){
+        Archetype *archetype = &archetypeManager.archetypes.at(entity->archetype);
+
+        std::size_t columnIndex = getColumnIndex(archetype, typeId);
+        void *component = getColumnData(archetype, columnIndex, entity->archetypeRow);
+
+        if(archetype->columns.at(columnIndex).isShared){
+            return getComponent(getEntity(*static_cast<EntityID*>(component)), typeId, componentTicks);
+        }
+        if(componentTicks != nullptr){
+            *componentTicks = getColumnTicks(archetype, columnIndex, entity->archetypeRow);
+        }
+        if(archetype->columns.at(columnIndex).isStable){
+            return *static_cast<void**>(component);
+        }
         return component;
     }
 
-    ECS::Entity* ECS::getEntity(EntityID entityID){
-        if(entityID < entityManager.entities.size()){
-            if(entityManager.entities.at(entityID).isTombstone == false){
-                return &entityManager.entities.at(entityID);
+    EntityID ECS::getComponentOwner(EntityID entityID, TypeID typeId){
+        Entity *entity = getEntity(entityID);
+        Archetype *archetype = &archetypeManager.archetypes.at(entity->archetype);
+
+        std::size_t columnIndex = getColumnIndex(archetype, typeId);
+
+        if(archetype->columns.at(columnIndex).isShared){
+            return *static_cast<EntityID*>(getColumnData(archetype, columnIndex, entity->archetypeRow));
+        }
+        return entityID;
+    }
+
+    bool ECS::hasComponent(Entity *entity, TypeID typeId){
+        return archetypeManager.archetypes.at(entity->archetype).signature.components.test(typeId);
+    }
+
+    std::vector<EntityID> ECS::getEntitiesWithComponent(TypeID typeId, bool includeShared){
+        std::vector<EntityID> entityIDs;
+
+        for(Archetype &archetype : archetypeManager.archetypes){
+            if(!archetype.signature.components.test(typeId)){continue;}
+            if(!includeShared && archetype.signature.sharedComponents.test(typeId)){continue;}
+
+            forEachArchetypeChunk(archetype, [&entityIDs](uint8_t *chunk, std::size_t rowCount){
+                EntityID *chunkEntityIDs = reinterpret_cast<EntityID*>(chunk);
+                entityIDs.insert(entityIDs.end(), chunkEntityIDs, chunkEntityIDs + rowCount);
+            });
+        }
+
+        return entityIDs;
+    }
+
+    std::size_t ECS::countEntitiesWithComponent(TypeID typeId){
+        std::size_t count = 0;
+
+        for(Archetype &archetype : archetypeManager.archetypes){
+            if(archetype.signature.components.test(typeId)){
+                count += archetype.size;
             }
         }
 
+        return count;
+    }
+
+    ECS::Entity* ECS::getEntity(EntityID entityID){
+        if(isEntityValid(entityID)){
+            return &entityManager.entities[getEntityIndex(entityID)];
+        }
+
         std::cerr << "ERROR: No entity with id '" << entityID << "'\n";
         throw std::exception();
     }
 
     std::vector<uint8_t> ECS::serializeComponent(TypeID componentTypeID, EntityID entityID){
+        std::vector<uint8_t> componentData;
+        Writer writer(componentData);
+        serializeComponent(componentTypeID, entityID, writer);
+        return componentData;
+    }
+    void ECS::serializeComponent(TypeID componentTypeID, EntityID entityID, Writer &writer){
         ComponentType *componentType = getComponentType(componentTypeID);
         if(componentType->serializeFunc == nullptr){
-            return {};
+            return;
         }
-        return componentType->serializeFunc(*this, entityID);
+        componentType->serializeFunc(*this, entityID, writer);
     }
-    void ECS::deserializeComponent(TypeID componentTypeID, EntityID entityID, const std::vector<uint8_t> componentData){
+    void ECS::deserializeComponent(TypeID componentTypeID, EntityID entityID, const std::vector<uint8_t> &componentData){
+        Reader reader(componentData);
+        deserializeComponent(componentTypeID, entityID, reader);
+    }
+    void ECS::deserializeComponent(TypeID componentTypeID, EntityID entityID, Reader &reader){
         ComponentType *componentType = getComponentType(componentTypeID);
         if(componentType->deserializeFunc == nullptr){
             return;
         }
-        componentType->deserializeFunc(*this, entityID, componentData);
+        componentType->deserializeFunc(*this, entityID, reader);
     }
 
-    void ECS::runAllComponentDeinitializes(ComponentType *componentType, TypeID typeId){
-        for(std::size_t i = 0; i < componentType->entitiesUsingThis.size(); i++){
-            EntityID entityID = componentType->entitiesUsingThis.at(i);
-            Entity *entity = &entityManager.entities.at(entityID);
+    static constexpr uint32_t SnapshotMagic = 0x53434542; // "BECS"
+    static constexpr uint32_t SnapshotVersion = 5;
 
-            if(entity->components.get(typeId)->parent == entityID){
-                if(componentType->deinitializeFunc != nullptr){
-                    componentType->deinitializeFunc(*this, entityID);
-                }
-            }
-        }
-    }
+    // Writes a snapshot to a stream, counting the bytes written so chunks can be aligned in the snapshot
+    class SnapshotWriter{
+    public:
+        SnapshotWriter(std::ostream &stream) : stream(stream){}
 
-    void ECS::pruneEntities(){
-        if(entityManager.tombstoneEntities.empty()){
-            return;
+        void writeBytes(const void *data, std::size_t size){
+            stream.write(static_cast<const char*>(data), size);
+            position += size;
         }
-        std::size_t i = entityManager.tombstoneEntities.size() - 1;
-        std::size_t expected = entityManager.entities.size() - 1;
-
-        while(entityManager.tombstoneEntities.at(i) == expected){
-            entityManager.entities.pop_back();
-            entityManager.tombstoneEntities.pop_back();
-            expected --;
-            if(i <= 0){
-                return;
-            }
-            i --;
+        template <typename T> void writeValue(const T &value){
+            writeBytes(&value, sizeof(T));
         }
-    }
-
-    TypeID ECS::getTypeID(std::string typeName){
-        auto it = componentManager.typeNamesToTypeIds.find(typeName);
-        if(it == componentManager.typeNamesToTypeIds.end()){
-            std::cerr << "ERROR: No component with name '" << typeName << "'\n";
-            throw std::exception();
+        void align(std::size_t alignment){
+            static const uint8_t padding[SnapshotChunkAlignment] = {};
+            writeBytes(padding, (alignment - position % alignment) % alignment);
         }
-        return it->second;
-    }
 
-    void ECS::displayECS(){
-        std::cout << "Component Types" << "\n" << "===============" << "\n";
+    private:
+        std::ostream &stream;
+        std::size_t position = 0;
+    };
 
-        for (const auto& entry : componentManager.componentTypes) {
-            std::string name = entry.second.name;
-            int count = entry.second.entitiesUsingThis.size();
-            int tombStoneCount = entry.second.tombstoneComponents.size();
+    // Reads a snapshot from a stream or from memory, memory snapshots lend their bytes instead of copying them
+    class SnapshotReader{
+    public:
+        SnapshotReader(std::istream &stream) : stream(&stream){}
+        SnapshotReader(uint8_t *data, std::size_t size) : data(data), size(size){}
 
-            std::cout <<  name << "\n   count: " << count << "\n   tomb stone count: " << tombStoneCount << "\n   tomb stone indexes: ";
-            for(int i = 0; i < entry.second.tombstoneComponents.size(); i++){
-                std::cout << entry.second.tombstoneComponents.at(i) << " ";
+        void readBytes(void *destination, std::size_t count){
+            if(count == 0){
+                return;
+            }
+            if(stream == nullptr){
+                std::memcpy(destination, lendBytes(count), count);
+                return;
             }
-            std::cout << "\n";
 
+            if(!stream->read(static_cast<char*>(destination), count)){
+                std::cerr << "ERROR: snapshot ended unexpectedly\n";
+                throw std::exception();
+            }
+            position += count;
         }
-        std::cout <<  "\n";
+        template <typename T> T readValue(){
+            T value;
+            readBytes(&value, sizeof(T));
+            return value;
+        }
+        uint8_t* lendBytes(std::size_t count){
+            if(stream != nullptr){
+                return nullptr;
+            }
 
-        std::cout << "Entities" << "\n" << "========" << "\n";
+            if(count > size - position){
+                std::cerr << "ERROR: snapshot ended unexpectedly\n";
+                throw std::exception();
+            }
+            uint8_t *bytes = data + position;
+            position += count;
+            return bytes;
+        }
+        bool canLendBytes(){
+            return stream == nullptr;
+        }
+        void align(std::size_t alignment){
+            std::size_t count = (alignment - position % alignment) % alignment;
+            if(stream == nullptr){
+                lendBytes(count);
+                return;
+            }
+
+            if(!stream->ignore(count)){
+                std::cerr << "ERROR: snapshot ended unexpectedly\n";
+                throw std::exception();
+            }
+            position += count;
+        }
+
+    private:
+        std::istream *stream = nullptr;
+        uint8_t *data = nullptr;
+        std::size_t size = 0;
+        std::size_t position = 0;
+    };
+
+    void ECS::saveSnapshot(std::ostream &stream){
+        SnapshotWriter writer(stream);
+        writeSnapshot(writer);
+    }
+
+    void ECS::saveSnapshot(const std::string &path){
+        std::ofstream stream(path, std::ios::binary);
+        if(!stream){
+            std::cerr << "ERROR: can't open snapshot '" << path << "'\n";
+            throw std::exception();
+        }
+        saveSnapshot(stream);
+    }
+
+    void ECS::loadSnapshot(std::istream &stream){
+        SnapshotReader reader(stream);
+        readSnapshot(reader);
+    }
+
+    void ECS::loadSnapshot(const std::string &path){
+    #if defined(__unix__) || defined(__APPLE__)
+        int file = open(path.c_str(), O_RDONLY);
+        if(file < 0){
+            std::cerr << "ERROR: can't open snapshot '" << path << "'\n";
+            throw std::exception();
+        }
+        struct stat fileStat;
+        if(fstat(file, &fileStat) != 0){
+            close(file);
+            std::cerr << "ERROR: can't open snapshot '" << path << "'\n";
+            throw std::exception();
+        }
+
+        // Private mappings are copy on write, so borrowed chunks can be changed without touching the file
+        std::size_t size = fileStat.st_size;
+        void *data = size > 0 ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0) : MAP_FAILED;
+        close(file);
+        if(data == MAP_FAILED){
+            std::cerr << "ERROR: can't map snapshot '" << path << "'\n";
+            throw std::exception();
+        }
+
+        // Unmaps the snapshot if it can't be read, readSnapshot has emptied the world by then so no chunk is borrowed from it
+        struct MappingOwner {
+            void *data;
+            std::size_t size;
+            ~MappingOwner(){
+                if(data != nullptr){
+                    munmap(data, size);
+                }
+            }
+        } mappingOwner{data, size};
+
+        SnapshotReader reader(static_cast<uint8_t*>(data), size);
+        readSnapshot(reader);
+
+        archetypeManager.mappedSnapshots.push_back({data, size});
+        mappingOwner.data = nullptr;
+    #else
+        std::ifstream stream(path, std::ios::binary);
+        if(!stream){
+            std::cerr << "ERROR: can't open snapshot '" << path << "'\n";
+            throw std::exception();
+        }
+        loadSnapshot(stream);
+    #endif
+    }
+
+    // Type IDs depend on the order of first use, so snapshots and deltas name their component types
+    void ECS::writeComponentTypes(SnapshotWriter &writer){
+        std::vector<TypeID> typeIds;
+        for(TypeID typeId = 0; typeId < componentManager.componentTypes.size(); typeId++){
+            if(componentManager.componentTypes[typeId].isRegistered){
+                typeIds.push_back(typeId);
+            }
+        }
+
+        writer.writeValue<uint64_t>(typeIds.size());
+        for(TypeID typeId : typeIds){
+            const ComponentType &componentType = componentManager.componentTypes[typeId];
+            writer.writeValue<uint64_t>(typeId);
+            writer.writeValue<uint64_t>(componentType.name.size());
+            writer.writeBytes(componentType.name.data(), componentType.name.size());
+            writer.writeValue<uint64_t>(componentType.size);
+            writer.writeValue<uint8_t>(componentType.isTrivial);
+            writer.writeValue<uint8_t>(componentType.isStable);
+        }
+    }
+
+    std::unordered_map<uint64_t, TypeID> ECS::readComponentTypes(SnapshotReader &reader){
+        std::unordered_map<uint64_t, TypeID> snapshotTypeIds;
+        std::string name;
+
+        uint64_t typeCount = reader.readValue<uint64_t>();
+        for(uint64_t i = 0; i < typeCount; i++){
+            uint64_t snapshotTypeId = reader.readValue<uint64_t>();
+            name.resize(reader.readValue<uint64_t>());
+            reader.readBytes(name.data(), name.size());
+            uint64_t size = reader.readValue<uint64_t>();
+            bool isTrivial = reader.readValue<uint8_t>();
+            bool isStable = reader.readValue<uint8_t>();
+
+            TypeID typeId = getTypeID(name);
+            ComponentType *componentType = getComponentType(typeId);
+            if(componentType->size != size || componentType->isTrivial != isTrivial || componentType->isStable != isStable){
+                std::cerr << "ERROR: component type '" << name << "' doesn't match the one in the snapshot\n";
+                throw std::exception();
+            }
+
+            snapshotTypeIds[snapshotTypeId] = typeId;
+        }
+
+        return snapshotTypeIds;
+    }
+
+    // Layout: header, component types, entities, free entity indexes, then every archetype with its columns.
+    // Archetypes with only trivial and shared columns are written as copies of their chunks, each aligned to
+    // SnapshotChunkAlignment so a mapped snapshot can be used as chunks directly. Other archetypes are written
+    // as their entity IDs, their raw column arrays, the ticks of every column and then the components that use
+    // their serialize function.
+    void ECS::writeSnapshot(SnapshotWriter &writer){
+        writer.writeValue(SnapshotMagic);
+        writer.writeValue(SnapshotVersion);
+        writer.writeValue<uint32_t>(changeManager.tick);
+
+        writeComponentTypes(writer);
+
+        writer.writeValue<uint64_t>(entityManager.entities.size());
+        for(const Entity &entity : entityManager.entities){
+            writer.writeValue<uint32_t>(entity.generation);
+            writer.writeValue<uint8_t>(entity.isTombstone);
+            if(entity.isTombstone){continue;}
+
+            writer.writeValue<uint64_t>(entity.entityGUID);
+            writer.writeValue<uint64_t>(entity.parentEntity);
+
+            std::size_t childCount = 0;
+            for(EntityID childEntityID = entity.firstChildEntity; childEntityID != RootEntityID; childEntityID = entityManager.entities[getEntityIndex(childEntityID)].nextSiblingEntity){
+                childCount++;
+            }
+            writer.writeValue<uint64_t>(childCount);
+            for(EntityID childEntityID = entity.firstChildEntity; childEntityID != RootEntityID; childEntityID = entityManager.entities[getEntityIndex(childEntityID)].nextSiblingEntity){
+                writer.writeValue<uint64_t>(childEntityID);
+            }
+        }
+
+        writer.writeValue<uint64_t>(entityManager.tombstoneEntities.size());
+        writer.writeBytes(entityManager.tombstoneEntities.data(), entityManager.tombstoneEntities.size() * sizeof(std::size_t));
+
+        std::size_t archetypeCount = 0;
+        for(const Archetype &archetype : archetypeManager.archetypes){
+            archetypeCount += archetype.size > 0;
+        }
+        writer.writeValue<uint64_t>(archetypeCount);
+
+        std::vector<uint8_t> chunkImage;
+        std::vector<uint8_t> componentData;
+
+        for(Archetype &archetype : archetypeManager.archetypes){
+            if(archetype.size == 0){continue;}
+
+            std::vector<std::size_t> rawColumns;
+            std::vector<std::size_t> serializedColumns;
+            for(std::size_t i = 0; i < archetype.columns.size(); i++){
+                const ArchetypeColumn &column = archetype.columns[i];
+                const ComponentType &componentType = componentManager.componentTypes[column.typeId];
+
+                if(column.isShared || (componentType.isTrivial && !column.isStable)){
+                    rawColumns.push_back(i);
+                }else if(componentType.serializeFunc != nullptr){
+                    serializedColumns.push_back(i);
+                }
+            }
+            bool isChunkImage = rawColumns.size() == archetype.columns.size();
+
+            writer.writeValue<uint8_t>(archetype.signature.isSharedValue);
+            writer.writeValue<uint64_t>(rawColumns.size() + serializedColumns.size());
+            for(std::vector<std::size_t> *columns : {&rawColumns, &serializedColumns}){
+                for(std::size_t columnIndex : *columns){
+                    const ArchetypeColumn &column = archetype.columns[columnIndex];
+                    writer.writeValue<uint64_t>(column.typeId);
+                    writer.writeValue<uint8_t>(column.isShared);
+                    writer.writeValue<uint64_t>(column.offset);
+                    writer.writeValue<uint64_t>(column.size);
+                    writer.writeValue<uint64_t>(column.tickOffset);
+                }
+            }
+            writer.writeValue<uint64_t>(archetype.size);
+            writer.writeValue<uint8_t>(isChunkImage);
+
+            if(isChunkImage){
+                writer.writeValue<uint64_t>(archetype.chunkCapacity);
+                writer.writeValue<uint64_t>(archetype.chunkBytes);
+
+                // Only the used rows are copied so unused rows and padding are written as zeros
+                chunkImage.resize(archetype.chunkBytes);
+                forEachArchetypeChunk(archetype, [&](uint8_t *chunk, std::size_t rowCount){
+                    std::fill(chunkImage.begin(), chunkImage.end(), 0);
+                    std::memcpy(chunkImage.data(), chunk, rowCount * sizeof(EntityID));
+                    for(const ArchetypeColumn &column : archetype.columns){
+                        std::memcpy(chunkImage.data() + column.offset, chunk + column.offset, rowCount * column.size);
+                        std::memcpy(chunkImage.data() + column.tickOffset, chunk + column.tickOffset, rowCount * sizeof(ComponentTicks));
+                    }
+
+                    writer.align(SnapshotChunkAlignment);
+                    writer.writeBytes(chunkImage.data(), chunkImage.size());
+                });
+                continue;
+            }
+
+            forEachRowRange(archetype, 0, archetype.size, [&writer](uint8_t *chunk, std::size_t chunkRow, std::size_t rowCount){
+                writer.writeBytes(reinterpret_cast<EntityID*>(chunk) + chunkRow, rowCount * sizeof(EntityID));
+            });
+
+            for(std::size_t columnIndex : rawColumns){
+                const ArchetypeColumn &column = archetype.columns[columnIndex];
+                forEachRowRange(archetype, 0, archetype.size, [&writer, &column](uint8_t *chunk, std::size_t chunkRow, std::size_t rowCount){
+                    writer.writeBytes(chunk + column.offset + chunkRow * column.size, rowCount * column.size);
+                });
+            }
+
+            for(std::vector<std::size_t> *columns : {&rawColumns, &serializedColumns}){
+                for(std::size_t columnIndex : *columns){
+                    const ArchetypeColumn &column = archetype.columns[columnIndex];
+                    forEachRowRange(archetype, 0, archetype.size, [&writer, &column](uint8_t *chunk, std::size_t chunkRow, std::size_t rowCount){
+                        writer.writeBytes(chunk + column.tickOffset + chunkRow * sizeof(ComponentTicks), rowCount * sizeof(ComponentTicks));
+                    });
+                }
+            }
+
+            for(std::size_t columnIndex : serializedColumns){
+                SerializeFunc serializeFunc = componentManager.componentTypes[archetype.columns[columnIndex].typeId].serializeFunc;
+
+                for(std::size_t row = 0; row < archetype.size; row++){
+                    componentData.clear();
+                    Writer componentWriter(componentData);
+                    serializeFunc(*this, *getRowEntityID(&archetype, row), componentWriter);
+
+                    writer.writeValue<uint64_t>(componentData.size());
+                    writer.writeBytes(componentData.data(), componentData.size());
+                }
+            }
+        }
+    }
+
+    void ECS::readSnapshot(SnapshotReader &reader){
+        if(reader.readValue<uint32_t>() != SnapshotMagic || reader.readValue<uint32_t>() != SnapshotVersion){
+            std::cerr << "ERROR: not a snapshot or the snapshot version is unsupported\n";
+            throw std::exception();
+        }
+
+        uint32_t tick = reader.readValue<uint32_t>();
+
+        clear();
+
+        // Ticks only move forward, the loaded components can't be newer than the current tick
+        changeManager.tick = std::max(changeManager.tick, tick);
+
+        // A snapshot that is truncated or corrupt leaves an empty world, the components it loaded are destroyed without
+        // their deinitialize functions since the initialise functions only run once the whole snapshot is read
+        try{
+            readSnapshotContents(reader);
+        }catch(...){
+            clearWorld();
+            throw;
+        }
+    }
+
+    void ECS::readSnapshotContents(SnapshotReader &reader){
+        std::unordered_map<uint64_t, TypeID> snapshotTypeIds = readComponentTypes(reader);
+
+        entityManager.entities.resize(reader.readValue<uint64_t>());
+        for(std::size_t i = 0; i < entityManager.entities.size(); i++){
+            Entity &entity = entityManager.entities[i];
+            entity.generation = reader.readValue<uint32_t>();
+            entity.isTombstone = reader.readValue<uint8_t>();
+            if(entity.isTombstone){continue;}
+
+            entity.entityGUID = reader.readValue<uint64_t>();
+            entity.parentEntity = reader.readValue<uint64_t>();
+
+            // The sibling links of the children are set here, the children's own records only set their parent
+            uint64_t childCount = reader.readValue<uint64_t>();
+            for(uint64_t j = 0; j < childCount; j++){
+                EntityID childEntityID = reader.readValue<uint64_t>();
+                std::size_t childIndex = getEntityIndex(childEntityID);
+                if(childIndex >= entityManager.entities.size()){
+                    std::cerr << "ERROR: snapshot has an unknown child entity\n";
+                    throw std::exception();
+                }
+
+                entityManager.entities[childIndex].previousSiblingEntity = entity.lastChildEntity;
+                if(entity.lastChildEntity != RootEntityID){
+                    entityManager.entities[getEntityIndex(entity.lastChildEntity)].nextSiblingEntity = childEntityID;
+                }else{
+                    entity.firstChildEntity = childEntityID;
+                }
+                entity.lastChildEntity = childEntityID;
+            }
+
+            entityManager.entityGUIDToEntityID[entity.entityGUID] = createEntityID(i, entity.generation);
+        }
+
+        entityManager.tombstoneEntities.resize(reader.readValue<uint64_t>());
+        reader.readBytes(entityManager.tombstoneEntities.data(), entityManager.tombstoneEntities.size() * sizeof(std::size_t));
+
+        struct SnapshotColumn {
+            TypeID typeId;
+            bool isShared;
+            bool isRaw;
+            std::size_t offset;
+            std::size_t size;
+            std::size_t tickOffset;
+        };
+
+        std::vector<SnapshotColumn> columns;
+        std::vector<ComponentTicks> serializedTicks;
+        std::vector<EntityID> rowEntities;
+        std::vector<std::pair<EntityID, TypeID>> componentsToInitialise;
+        std::vector<uint8_t> data;
+
+        uint64_t archetypeCount = reader.readValue<uint64_t>();
+        for(uint64_t i = 0; i < archetypeCount; i++){
+            ArchetypeSignature signature;
+            signature.isSharedValue = reader.readValue<uint8_t>();
+
+            columns.resize(reader.readValue<uint64_t>());
+            std::size_t rawColumnCount = 0;
+            for(SnapshotColumn &column : columns){
+                uint64_t snapshotTypeId = reader.readValue<uint64_t>();
+                column.isShared = reader.readValue<uint8_t>();
+                column.offset = reader.readValue<uint64_t>();
+                column.size = reader.readValue<uint64_t>();
+                column.tickOffset = reader.readValue<uint64_t>();
+
+                auto it = snapshotTypeIds.find(snapshotTypeId);
+                if(it == snapshotTypeIds.end()){
+                    std::cerr << "ERROR: snapshot column has an unknown component type\n";
+                    throw std::exception();
+                }
+                column.typeId = it->second;
+                column.isRaw = column.isShared || (getComponentType(column.typeId)->isTrivial && !getComponentType(column.typeId)->isStable);
+
+                if(column.isRaw){
+                    signature.components.set(column.typeId);
+                    signature.sharedComponents.set(column.typeId, column.isShared);
+                    rawColumnCount++;
+                }
+            }
+
+            // The serialized columns are added with their deserialize function once the rows are in place
+            std::size_t archetypeIndex = getArchetype(signature);
+            Archetype *archetype = &archetypeManager.archetypes[archetypeIndex];
+            std::size_t rowCount = reader.readValue<uint64_t>();
+            bool isChunkImage = reader.readValue<uint8_t>();
+            std::size_t firstRow = archetype->size;
+
+            if(isChunkImage){
+                std::size_t chunkCapacity = reader.readValue<uint64_t>();
+                std::size_t chunkBytes = reader.readValue<uint64_t>();
+
+                bool isSameLayout = archetype->chunkCapacity == chunkCapacity && archetype->chunkBytes == chunkBytes;
+                for(const SnapshotColumn &column : columns){
+                    const ArchetypeColumn &localColumn = archetype->columns[getColumnIndex(archetype, column.typeId)];
+                    isSameLayout = isSameLayout && localColumn.offset == column.offset && localColumn.size == column.size && localColumn.tickOffset == column.tickOffset;
+                }
+                bool canBorrowChunks = isSameLayout && reader.canLendBytes() && archetype->size == 0 && archetype->chunkAlignment <= SnapshotChunkAlignment;
+
+                for(std::size_t row = 0; row < rowCount; row += chunkCapacity){
+                    std::size_t chunkRowCount = std::min(chunkCapacity, rowCount - row);
+                    reader.align(SnapshotChunkAlignment);
+
+                    if(canBorrowChunks){
+                        archetype->chunks.push_back(reader.lendBytes(chunkBytes));
+                        resizeChunkChangeTicks(archetype);
+                        archetype->borrowedChunkCount++;
+                        archetype->size += chunkRowCount;
+                        continue;
+                    }
+
+                    const uint8_t *chunkImage = reader.lendBytes(chunkBytes);
+                    if(chunkImage == nullptr){
+                        data.resize(chunkBytes);
+                        reader.readBytes(data.data(), chunkBytes);
+                        chunkImage = data.data();
+                    }
+
+                    std::size_t imageFirstRow = archetype->size;
+                    reserveArchetypeRows(archetype, chunkRowCount);
+                    for(std::size_t j = 0; j < chunkRowCount; j++){
+                        addArchetypeRow(archetype);
+                    }
+
+                    auto copyRows = [&](std::size_t offset, const uint8_t *source, std::size_t size){
+                        forEachRowRange(*archetype, imageFirstRow, chunkRowCount, [&](uint8_t *chunk, std::size_t chunkRow, std::size_t count){
+                            std::memcpy(chunk + offset + chunkRow * size, source, count * size);
+                            source += count * size;
+                        });
+                    };
+
+                    copyRows(0, chunkImage, sizeof(EntityID));
+                    for(const SnapshotColumn &column : columns){
+                        const ArchetypeColumn &localColumn = archetype->columns[getColumnIndex(archetype, column.typeId)];
+                        copyRows(localColumn.offset, chunkImage + column.offset, column.size);
+                        copyRows(localColumn.tickOffset, chunkImage + column.tickOffset, sizeof(ComponentTicks));
+                    }
+                }
+            }else{
+                reserveArchetypeRows(archetype, rowCount);
+                for(std::size_t row = 0; row < rowCount; row++){
+                    addArchetypeRow(archetype);
+                }
+
+                forEachRowRange(*archetype, firstRow, rowCount, [&reader](uint8_t *chunk, std::size_t chunkRow, std::size_t rowCount){
+                    reader.readBytes(reinterpret_cast<EntityID*>(chunk) + chunkRow, rowCount * sizeof(EntityID));
+                });
+
+                for(std::size_t columnIndex = 0; columnIndex < rawColumnCount; columnIndex++){
+                    const ArchetypeColumn &column = archetype->columns[getColumnIndex(archetype, columns[columnIndex].typeId)];
+                    forEachRowRange(*archetype, firstRow, rowCount, [&reader, &column](uint8_t *chunk, std::size_t chunkRow, std::size_t rowCount){
+                        reader.readBytes(chunk + column.offset + chunkRow * column.size, rowCount * column.size);
+                    });
+                }
+
+                for(std::size_t columnIndex = 0; columnIndex < rawColumnCount; columnIndex++){
+                    const ArchetypeColumn &column = archetype->columns[getColumnIndex(archetype, columns[columnIndex].typeId)];
+                    forEachRowRange(*archetype, firstRow, rowCount, [&reader, &column](uint8_t *chunk, std::size_t chunkRow, std::size_t rowCount){
+                        reader.readBytes(chunk + column.tickOffset + chunkRow * sizeof(ComponentTicks), rowCount * sizeof(ComponentTicks));
+                    });
+                }
+
+                // The serialized columns don't exist until their components are deserialized, so their ticks are set after
+                serializedTicks.resize((columns.size() - rawColumnCount) * rowCount);
+                reader.readBytes(serializedTicks.data(), serializedTicks.size() * sizeof(ComponentTicks));
+            }
+
+            rowEntities.resize(rowCount);
+            for(std::size_t row = 0; row < rowCount; row++){
+                rowEntities[row] = *getRowEntityID(archetype, firstRow + row);
+
+                Entity *entity = getEntity(rowEntities[row]);
+                entity->archetype = archetypeIndex;
+                entity->archetypeRow = firstRow + row;
+            }
+
+            for(std::size_t columnIndex = 0; columnIndex < rawColumnCount; columnIndex++){
+                TypeID typeId = columns[columnIndex].typeId;
+                if(columns[columnIndex].isShared || getComponentType(typeId)->initialiseFunc == nullptr){continue;}
+
+                for(EntityID entityID : rowEntities){
+                    componentsToInitialise.push_back({entityID, typeId});
+                }
+            }
+
+            for(std::size_t columnIndex = rawColumnCount; columnIndex < columns.size(); columnIndex++){
+                TypeID typeId = columns[columnIndex].typeId;
+
+                for(EntityID entityID : rowEntities){
+                    std::size_t size = reader.readValue<uint64_t>();
+
+                    // Mapped snapshots are read in place, streams are read into one reused buffer
+                    const uint8_t *componentData = reader.lendBytes(size);
+                    if(componentData == nullptr){
+                        data.resize(size);
+                        reader.readBytes(data.data(), size);
+                        componentData = data.data();
+                    }
+
+                    Reader componentReader(componentData, size);
+                    deserializeComponent(typeId, entityID, componentReader);
+                }
+
+                const ComponentTicks *ticks = serializedTicks.data() + (columnIndex - rawColumnCount) * rowCount;
+                for(std::size_t row = 0; row < rowCount; row++){
+                    Entity *entity = getEntity(rowEntities[row]);
+                    if(!hasComponent(entity, typeId)){continue;}
+
+                    ComponentTicks *componentTicks;
+                    getComponent(entity, typeId, &componentTicks);
+                    *componentTicks = ticks[row];
+                }
+            }
+        }
+
+        // The ticks of raw rows are copied as bytes
+        for(Archetype &archetype : archetypeManager.archetypes){
+            updateChunkChangeTicks(&archetype);
+        }
+
+        for(const auto &[entityID, typeId] : componentsToInitialise){
+            getComponentType(typeId)->initialiseFunc(*this, entityID);
+        }
+
+        countSharedComponents();
+    }
+
+    static constexpr uint32_t DeltaMagic = 0x44434542; // "BECD"
+    static constexpr uint32_t DeltaVersion = 3;
+
+    // Layout: header, component types, removed entity GUIDs, removed components of the remaining entities, then
+    // every entity with changed components as its GUID, whether it holds a shared value and those components. Shared
+    // components are written as the GUID of the entity that owns them, components without a serialize function are skipped.
+    void ECS::saveDelta(std::ostream &stream, uint32_t sinceTick){
+        SnapshotWriter writer(stream);
+        writer.writeValue(DeltaMagic);
+        writer.writeValue(DeltaVersion);
+
+        writeComponentTypes(writer);
+
+        auto isAfterSinceTick = [sinceTick](const auto &removal){ return removal.tick > sinceTick; };
+
+        const std::vector<RemovedEntity> &removedEntities = changeManager.removedEntities;
+        auto firstRemovedEntity = std::find_if(removedEntities.begin(), removedEntities.end(), isAfterSinceTick);
+        writer.writeValue<uint64_t>(removedEntities.end() - firstRemovedEntity);
+        for(auto it = firstRemovedEntity; it != removedEntities.end(); it++){
+            writer.writeValue<uint64_t>(it->entityGUID);
+        }
+
+        // The components of removed entities go with their entity
+        std::vector<std::pair<EntityGUID, TypeID>> removedComponents;
+        const std::vector<RemovedComponent> &componentRemovals = changeManager.removedComponents;
+        for(auto it = std::find_if(componentRemovals.begin(), componentRemovals.end(), isAfterSinceTick); it != componentRemovals.end(); it++){
+            if(isEntityValid(it->entityID) && componentTypeExists(it->typeId)){
+                removedComponents.push_back({getEntityGUID(it->entityID), it->typeId});
+            }
+        }
+        writer.writeValue<uint64_t>(removedComponents.size());
+        for(const auto &[entityGUID, typeId] : removedComponents){
+            writer.writeValue<uint64_t>(entityGUID);
+            writer.writeValue<uint64_t>(typeId);
+        }
+
+        auto isSerializable = [&](const ArchetypeColumn &column){
+            return column.isShared || componentManager.componentTypes[column.typeId].serializeFunc != nullptr;
+        };
+        auto isColumnChanged = [&](Archetype &archetype, std::size_t columnIndex, std::size_t row){
+            return isSerializable(archetype.columns[columnIndex]) && getColumnTicks(&archetype, columnIndex, row)->changed > sinceTick;
+        };
+
+        // Only the rows of chunks with a column changed after sinceTick are checked
+        std::vector<std::pair<Archetype*, std::size_t>> changedRows;
+        for(Archetype &archetype : archetypeManager.archetypes){
+            for(std::size_t chunkIndex = 0; chunkIndex < archetype.chunks.size(); chunkIndex++){
+                std::size_t firstRow = chunkIndex * archetype.chunkCapacity;
+
+                bool isChunkChanged = false;
+                for(std::size_t columnIndex = 0; columnIndex < archetype.columns.size() && !isChunkChanged; columnIndex++){
+                    uint32_t changeTick = archetype.chunkChangeTicks[getChunkChangeTickIndex(&archetype, columnIndex, firstRow)].tick.load(std::memory_order_relaxed);
+                    isChunkChanged = isSerializable(archetype.columns[columnIndex]) && changeTick > sinceTick;
+                }
+                if(!isChunkChanged){continue;}
+
+                std::size_t endRow = std::min(archetype.size, firstRow + archetype.chunkCapacity);
+                for(std::size_t row = firstRow; row < endRow; row++){
+                    for(std::size_t columnIndex = 0; columnIndex < archetype.columns.size(); columnIndex++){
+                        if(isColumnChanged(archetype, columnIndex, row)){
+                            changedRows.push_back({&archetype, row});
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        std::vector<std::size_t> changedColumns;
+        std::vector<uint8_t> componentData;
+
+        writer.writeValue<uint64_t>(changedRows.size());
+        for(const auto &[archetype, row] : changedRows){
+            EntityID entityID = *getRowEntityID(archetype, row);
+
+            changedColumns.clear();
+            for(std::size_t columnIndex = 0; columnIndex < archetype->columns.size(); columnIndex++){
+                if(isColumnChanged(*archetype, columnIndex, row)){
+                    changedColumns.push_back(columnIndex);
+                }
+            }
+
+            writer.writeValue<uint64_t>(getEntityGUID(entityID));
+            writer.writeValue<uint8_t>(archetype->signature.isSharedValue);
+            writer.writeValue<uint64_t>(changedColumns.size());
+            for(std::size_t columnIndex : changedColumns){
+                const ArchetypeColumn &column = archetype->columns[columnIndex];
+                writer.writeValue<uint64_t>(column.typeId);
+                writer.writeValue<uint8_t>(column.isShared);
+
+                if(column.isShared){
+                    writer.writeValue<uint64_t>(getEntityGUID(*static_cast<EntityID*>(getColumnData(archetype, columnIndex, row))));
+                    continue;
+                }
+
+                componentData.clear();
+                Writer componentWriter(componentData);
+                serializeComponent(column.typeId, entityID, componentWriter);
+
+                writer.writeValue<uint64_t>(componentData.size());
+                writer.writeBytes(componentData.data(), componentData.size());
+            }
+        }
+    }
+
+    void ECS::loadDelta(std::istream &stream){
+        SnapshotReader reader(stream);
+        if(reader.readValue<uint32_t>() != DeltaMagic || reader.readValue<uint32_t>() != DeltaVersion){
+            std::cerr << "ERROR: not a delta or the delta version is unsupported\n";
+            throw std::exception();
+        }
+
+        std::unordered_map<uint64_t, TypeID> snapshotTypeIds = readComponentTypes(reader);
+        auto readTypeId = [&reader, &snapshotTypeIds](){
+            auto it = snapshotTypeIds.find(reader.readValue<uint64_t>());
+            if(it == snapshotTypeIds.end()){
+                std::cerr << "ERROR: delta has an unknown component type\n";
+                throw std::exception();
+            }
+            return it->second;
+        };
+
+        uint64_t removedEntityCount = reader.readValue<uint64_t>();
+        for(uint64_t i = 0; i < removedEntityCount; i++){
+            // Children are removed with their parent so they can already be gone
+            auto it = entityManager.entityGUIDToEntityID.find(reader.readValue<uint64_t>());
+            if(it != entityManager.entityGUIDToEntityID.end()){
+                removeEntity(it->second);
+            }
+        }
+
+        uint64_t removedComponentCount = reader.readValue<uint64_t>();
+        for(uint64_t i = 0; i < removedComponentCount; i++){
+            auto it = entityManager.entityGUIDToEntityID.find(reader.readValue<uint64_t>());
+            TypeID typeId = readTypeId();
+
+            if(it != entityManager.entityGUIDToEntityID.end() && hasComponent(getEntity(it->second), typeId)){
+                removeComponent(it->second, typeId);
+            }
+        }
+
+        // Owners of shared components can come later in the delta, so shared components are added last
+        struct SharedComponent {
+            EntityID entityID;
+            TypeID typeId;
+            EntityGUID ownerGUID;
+        };
+        std::vector<SharedComponent> sharedComponents;
+        std::vector<uint8_t> data;
+
+        uint64_t entityCount = reader.readValue<uint64_t>();
+        for(uint64_t i = 0; i < entityCount; i++){
+            EntityGUID entityGUID = reader.readValue<uint64_t>();
+            bool isSharedValue = reader.readValue<uint8_t>();
+
+            EntityID entityID;
+            auto it = entityManager.entityGUIDToEntityID.find(entityGUID);
+            if(it != entityManager.entityGUIDToEntityID.end()){
+                entityID = it->second;
+            }else if(isSharedValue){
+                ArchetypeSignature signature;
+                signature.isSharedValue = true;
+                entityID = createEntity(entityGUID, getArchetype(signature));
+            }else{
+                addEntity(entityID, entityGUID);
+            }
+
+            uint64_t componentCount = reader.readValue<uint64_t>();
+            for(uint64_t j = 0; j < componentCount; j++){
+                TypeID typeId = readTypeId();
+                bool isShared = reader.readValue<uint8_t>();
+
+                if(isShared){
+                    sharedComponents.push_back({entityID, typeId, reader.readValue<uint64_t>()});
+                    continue;
+                }
+
+                data.resize(reader.readValue<uint64_t>());
+                reader.readBytes(data.data(), data.size());
+
+                Reader componentReader(data.data(), data.size());
+                deserializeComponent(typeId, entityID, componentReader);
+            }
+        }
+
+        for(const SharedComponent &sharedComponent : sharedComponents){
+            addComponent(sharedComponent.entityID, getEntityID(sharedComponent.ownerGUID), sharedComponent.typeId);
+        }
+
+        // New shared values are hashed when their type is next shared by value
+        for(SharedValues &sharedValues : sharedComponentManager.sharedValues){
+            sharedValues.isIndexed = false;
+        }
+    }
+
+    void ECS::runAllComponentDeinitializes(ComponentType *componentType, TypeID typeId){
+        if(componentType->deinitializeFunc == nullptr){
+            return;
+        }
+
+        std::vector<EntityID> entityIDs = getEntitiesWithComponent(typeId, false);
+
+        for(std::size_t i = 0; i < entityIDs.size(); i++){
+            componentType->deinitializeFunc(*this, entityIDs.at(i));
+        }
+    }
+
+    std::size_t ECS::getArchetype(const ArchetypeSignature &signature){
+        auto it = archetypeManager.signaturesToArchetypes.find(signature);
+        if(it != archetypeManager.signaturesToArchetypes.end()){
+            return it->second;
+        }
+
+        Archetype archetype;
+        archetype.signature = signature;
+        archetype.version = nextArchetypeVersion();
+        archetype.chunkAlignment = std::max(alignof(EntityID), alignof(ComponentTicks));
+
+        std::size_t rowBytes = sizeof(EntityID);
+
+        for(TypeID typeId = 0; typeId < componentManager.componentTypes.size(); typeId++){
+            if(!signature.components.test(typeId)){continue;}
+
+            bool isShared = signature.sharedComponents.test(typeId);
+            ComponentType *componentType = getComponentType(typeId);
+
+            bool isStable = !isShared && componentType->isStable;
+
+            ArchetypeColumn column = {
+                .typeId = typeId,
+                .isShared = isShared,
+                .isStable = isStable,
+                .size = isShared ? sizeof(EntityID) : isStable ? sizeof(void*) : componentType->size,
+                .alignment = isShared ? alignof(EntityID) : isStable ? alignof(void*) : componentType->alignment,
+                .offset = 0,
+                .tickOffset = 0,
+                .moveComponentFunc = isShared ? nullptr : componentType->moveComponentFunc,
+                .destroyComponentFunc = isShared ? nullptr : componentType->destroyComponentFunc
+            };
+
+            rowBytes += column.size + sizeof(ComponentTicks);
+            archetype.chunkAlignment = std::max(archetype.chunkAlignment, column.alignment);
+
+            archetype.columnIndexes.insert(typeId, archetype.columns.size());
+            archetype.columns.push_back(column);
+        }
+
+        // Lay out the columns for a given capacity and shrink the capacity until the chunk fits
+        auto layoutColumns = [&archetype](std::size_t capacity){
+            std::size_t offset = capacity * sizeof(EntityID);
+            for(std::size_t i = 0; i < archetype.columns.size(); i++){
+                ArchetypeColumn &column = archetype.columns.at(i);
+                offset = (offset + column.alignment - 1) / column.alignment * column.alignment;
+                column.offset = offset;
+                offset += capacity * column.size;
+
+                offset = (offset + alignof(ComponentTicks) - 1) / alignof(ComponentTicks) * alignof(ComponentTicks);
+                column.tickOffset = offset;
+                offset += capacity * sizeof(ComponentTicks);
+            }
+            return offset;
+        };
+
+        archetype.chunkCapacity = std::max<std::size_t>(1, ArchetypeChunkSize / rowBytes);
+        archetype.chunkBytes = layoutColumns(archetype.chunkCapacity);
+        while(archetype.chunkBytes > ArchetypeChunkSize && archetype.chunkCapacity > 1){
+            archetype.chunkCapacity --;
+            archetype.chunkBytes = layoutColumns(archetype.chunkCapacity);
+        }
+
+        archetypeManager.archetypes.push_back(std::move(archetype));
+        std::size_t archetypeIndex = archetypeManager.archetypes.size() - 1;
+        archetypeManager.signaturesToArchetypes[signature] = archetypeIndex;
+
+        std::unique_lock<std::shared_mutex> lock(queryManager.mutex);
+        for(std::unique_ptr<QueryCache> &query : queryManager.queries){
+            if(query->isMatch(signature)){
+                query->archetypes.push_back(archetypeIndex);
+            }
+        }
+
+        return archetypeIndex;
+    }
+
+    ECS::QueryCache* ECS::getQuery(const QueryFilter &filter){
+        {
+            std::shared_lock<std::shared_mutex> lock(queryManager.mutex);
+            auto it = queryManager.filtersToQueries.find(filter);
+            if(it != queryManager.filtersToQueries.end()){
+                return it->second;
+            }
+        }
+
+        std::unique_lock<std::shared_mutex> lock(queryManager.mutex);
+        // Another thread can have created the query since the shared lock was released
+        auto it = queryManager.filtersToQueries.find(filter);
+        if(it != queryManager.filtersToQueries.end()){
+            return it->second;
+        }
+
+        std::unique_ptr<QueryCache> query = std::make_unique<QueryCache>();
+        query->filter = filter;
+        for(std::size_t i = 0; i < archetypeManager.archetypes.size(); i++){
+            if(!archetypeManager.archetypes[i].isRetired && query->isMatch(archetypeManager.archetypes[i].signature)){
+                query->archetypes.push_back(i);
+            }
+        }
+
+        queryManager.queries.push_back(std::move(query));
+        queryManager.filtersToQueries[filter] = queryManager.queries.back().get();
+
+        return queryManager.queries.back().get();
+    }
+
+    std::size_t ECS::countQueryEntities(const QueryCache &query){
+        std::size_t count = 0;
+        for(std::size_t archetypeIndex : query.archetypes){
+            count += archetypeManager.archetypes[archetypeIndex].size;
+        }
+        return count;
+    }
+
+    std::size_t ECS::getArchetypeWith(std::size_t archetypeIndex, std::size_t typeId, bool isShared){
+        Archetype *archetype = &archetypeManager.archetypes.at(archetypeIndex);
+        ComponentMap<std::size_t> *edges = isShared ? &archetype->addSharedComponentEdges : &archetype->addComponentEdges;
+
+        std::size_t *edge = edges->get(typeId);
+        if(edge != nullptr){
+            return *edge;
+        }
+
+        ArchetypeSignature signature = archetype->signature;
+        signature.components.set(typeId);
+        signature.sharedComponents.set(typeId, isShared);
+
+        std::size_t nextArchetypeIndex = getArchetype(signature);
+
+        archetype = &archetypeManager.archetypes.at(archetypeIndex);
+        edges = isShared ? &archetype->addSharedComponentEdges : &archetype->addComponentEdges;
+        edges->insert(typeId, nextArchetypeIndex);
+
+        return nextArchetypeIndex;
+    }
+
+    std::size_t ECS::getArchetypeWithout(std::size_t archetypeIndex, std::size_t typeId){
+        Archetype *archetype = &archetypeManager.archetypes.at(archetypeIndex);
+
+        std::size_t *edge = archetype->removeComponentEdges.get(typeId);
+        if(edge != nullptr){
+            return *edge;
+        }
+
+        ArchetypeSignature signature = archetype->signature;
+        signature.components.reset(typeId);
+        signature.sharedComponents.reset(typeId);
+
+        std::size_t nextArchetypeIndex = getArchetype(signature);
+
+        archetype = &archetypeManager.archetypes.at(archetypeIndex);
+        archetype->removeComponentEdges.insert(typeId, nextArchetypeIndex);
+
+        return nextArchetypeIndex;
+    }
+
+    std::size_t ECS::addArchetypeRow(Archetype *archetype){
+        std::size_t row = archetype->size;
+        archetype->size ++;
+
+        if(row / archetype->chunkCapacity >= archetype->chunks.size()){
+            void *chunk = archetypeManager.chunkPool.allocate(archetype->chunkBytes, archetype->chunkAlignment);
+            archetype->chunks.push_back(static_cast<uint8_t*>(chunk));
+            resizeChunkChangeTicks(archetype);
+        }
+
+        return row;
+    }
+
+    void ECS::reserveArchetypeRows(Archetype *archetype, std::size_t count){
+        std::size_t chunksNeeded = (archetype->size + count + archetype->chunkCapacity - 1) / archetype->chunkCapacity;
+        archetype->chunks.reserve(chunksNeeded);
+
+        while(archetype->chunks.size() < chunksNeeded){
+            void *chunk = archetypeManager.chunkPool.allocate(archetype->chunkBytes, archetype->chunkAlignment);
+            archetype->chunks.push_back(static_cast<uint8_t*>(chunk));
+        }
+        resizeChunkChangeTicks(archetype);
+    }
+
+    void ECS::removeArchetypeRow(Archetype *archetype, std::size_t row){
+        std::size_t lastRow = archetype->size - 1;
+
+        // The components of the removed row are already destroyed, so the last row is moved into the hole
+        if(row != lastRow){
+            EntityID movedEntityID = *getRowEntityID(archetype, lastRow);
+            *getRowEntityID(archetype, row) = movedEntityID;
+
+            for(std::size_t i = 0; i < archetype->columns.size(); i++){
+                const ArchetypeColumn &column = archetype->columns.at(i);
+                moveColumnComponent(column, getColumnData(archetype, i, row), getColumnData(archetype, i, lastRow));
+                *getColumnTicks(archetype, i, row) = *getColumnTicks(archetype, i, lastRow);
+                raiseChunkChangeTick(archetype, getChunkChangeTickIndex(archetype, i, row), getColumnTicks(archetype, i, row)->changed);
+            }
+
+            entityManager.entities.at(getEntityIndex(movedEntityID)).archetypeRow = row;
+        }
+
+        archetype->size --;
+        archetype->version = nextArchetypeVersion();
+
+        std::size_t chunksUsed = (archetype->size + archetype->chunkCapacity - 1) / archetype->chunkCapacity;
+        while(archetype->chunks.size() > chunksUsed){
+            freeLastArchetypeChunk(archetype);
+        }
+    }
+
+    void ECS::getHierarchySeeds(TypeID sourceTypeId, TypeID targetTypeId, uint32_t sinceTick, std::vector<std::size_t> &dirtyNodes, std::vector<std::size_t> &changedNodes){
+        const std::vector<HierarchyNode> &nodes = hierarchyManager.nodes;
+        const std::vector<std::size_t> &entityNodes = hierarchyManager.entityNodes;
+
+        auto getNode = [&](EntityID entityID){
+            std::size_t entityIndex = getEntityIndex(entityID);
+            if(entityIndex >= entityNodes.size() || entityNodes[entityIndex] == RootEntityID || nodes[entityNodes[entityIndex]].entityID != entityID){
+                return std::size_t(RootEntityID);
+            }
+            return entityNodes[entityIndex];
+        };
+
+        // Entities whose Source changed or whose Target was added are propagated, the children of any changed Target are too
+        for(Archetype &archetype : archetypeManager.archetypes){
+            if(archetype.isRetired || archetype.signature.isSharedValue || !archetype.signature.components.test(targetTypeId)){continue;}
+
+            const ArchetypeColumn &targetColumn = archetype.columns[*archetype.columnIndexes.get(targetTypeId)];
+            const bool isPropagated = archetype.signature.components.test(sourceTypeId) && !targetColumn.isShared;
+            const ArchetypeColumn *sourceColumn = isPropagated ? &archetype.columns[*archetype.columnIndexes.get(sourceTypeId)] : nullptr;
+
+            forEachArchetypeChunk(archetype, [&](uint8_t *chunk, std::size_t rowCount){
+                EntityID *entityIDs = reinterpret_cast<EntityID*>(chunk);
+
+                for(std::size_t row = 0; row < rowCount; row++){
+                    ComponentTicks targetTicks = getColumnComponentTicks(targetColumn, chunk, row);
+                    bool isTargetChanged = targetTicks.changed > sinceTick;
+                    bool isDirty = isPropagated && (targetTicks.added > sinceTick || getColumnComponentTicks(*sourceColumn, chunk, row).changed > sinceTick);
+                    if(!isTargetChanged && !isDirty){continue;}
+
+                    std::size_t node = getNode(entityIDs[row]);
+                    if(node == RootEntityID){continue;}
+
+                    if(isDirty){
+                        dirtyNodes.push_back(node);
+                    }
+                    if(isTargetChanged){
+                        changedNodes.push_back(node);
+                    }
+                }
+            });
+        }
+
+        // Moved entities are only looked for when something moved since the last propagation
+        if(hierarchyManager.lastParentChangeTick > sinceTick){
+            for(std::size_t node = 0; node < nodes.size(); node++){
+                if(nodes[node].parentChangeTick > sinceTick){
+                    dirtyNodes.push_back(node);
+                }
+            }
+        }
+
+        for(std::vector<std::size_t> *nodeList : {&dirtyNodes, &changedNodes}){
+            std::sort(nodeList->begin(), nodeList->end());
+            nodeList->erase(std::unique(nodeList->begin(), nodeList->end()), nodeList->end());
+        }
+    }
+
+    void ECS::retireArchetypes(TypeID typeId){
+        for(Archetype &archetype : archetypeManager.archetypes){
+            if(archetype.isRetired || !archetype.signature.components.test(typeId)){continue;}
+
+            // Every component of the type was removed, so the rows left are the ones of other archetypes
+            while(!archetype.chunks.empty()){
+                freeLastArchetypeChunk(&archetype);
+            }
+            archetypeManager.signaturesToArchetypes.erase(archetype.signature);
+
+            archetype.isRetired = true;
+            archetype.size = 0;
+            archetype.version = nextArchetypeVersion();
+            archetype.signature = ArchetypeSignature{};
+            archetype.columns.clear();
+            archetype.columnIndexes = ComponentMap<std::size_t>{};
+            archetype.addComponentEdges = ComponentMap<std::size_t>{};
+            archetype.addSharedComponentEdges = ComponentMap<std::size_t>{};
+            archetype.removeComponentEdges = ComponentMap<std::size_t>{};
+        }
+
+        auto eraseRetiredEdges = [this](ComponentMap<std::size_t> &edges){
+            std::vector<std::size_t> retiredKeys;
+            edges.forEach([&](std::size_t key, std::size_t archetypeIndex){
+                if(archetypeManager.archetypes[archetypeIndex].isRetired){
+                    retiredKeys.push_back(key);
+                }
+            });
+            for(std::size_t key : retiredKeys){
+                edges.erase(key);
+            }
+        };
+        for(Archetype &archetype : archetypeManager.archetypes){
+            if(archetype.isRetired){continue;}
+
+            eraseRetiredEdges(archetype.addComponentEdges);
+            eraseRetiredEdges(archetype.addSharedComponentEdges);
+            eraseRetiredEdges(archetype.removeComponentEdges);
+        }
+
+        std::unique_lock<std::shared_mutex> lock(queryManager.mutex);
+        for(std::unique_ptr<QueryCache> &query : queryManager.queries){
+            query->archetypes.erase(std::remove_if(query->archetypes.begin(), query->archetypes.end(), [this](std::size_t archetypeIndex){
+                return archetypeManager.archetypes[archetypeIndex].isRetired;
+            }), query->archetypes.end());
+        }
+    }
+
+    void ECS::freeLastArchetypeChunk(Archetype *archetype){
+        // Borrowed chunks belong to a mapped snapshot and are released when it is unmapped
+        if(archetype->chunks.size() <= archetype->borrowedChunkCount){
+            archetype->borrowedChunkCount--;
+        }else{
+            archetypeManager.chunkPool.deallocate(archetype->chunks.back(), archetype->chunkBytes, archetype->chunkAlignment);
+        }
+        archetype->chunks.pop_back();
+        resizeChunkChangeTicks(archetype);
+    }
+
+    void ECS::moveEntity(EntityID entityID, std::size_t archetypeIndex){
+        Entity *entity = getEntity(entityID);
+        if(entity->archetype == archetypeIndex){
+            return;
+        }
+
+        Archetype *source = &archetypeManager.archetypes.at(entity->archetype);
+        Archetype *destination = &archetypeManager.archetypes.at(archetypeIndex);
+
+        std::size_t sourceRow = entity->archetypeRow;
+        std::size_t row = addArchetypeRow(destination);
+        *getRowEntityID(destination, row) = entityID;
+
+        for(std::size_t i = 0; i < source->columns.size(); i++){
+            const ArchetypeColumn &column = source->columns.at(i);
+            void *sourceData = getColumnData(source, i, sourceRow);
+
+            std::size_t *destinationColumn = destination->columnIndexes.get(column.typeId);
+
+            if(destinationColumn != nullptr && destination->columns.at(*destinationColumn).isShared == column.isShared){
+                moveColumnComponent(column, getColumnData(destination, *destinationColumn, row), sourceData);
+                *getColumnTicks(destination, *destinationColumn, row) = *getColumnTicks(source, i, sourceRow);
+                raiseChunkChangeTick(destination, getChunkChangeTickIndex(destination, *destinationColumn, row), getColumnTicks(source, i, sourceRow)->changed);
+            }else{
+                destroyColumnComponent(column, sourceData);
+            }
+        }
+
+        removeArchetypeRow(source, sourceRow);
+
+        entity->archetype = archetypeIndex;
+        entity->archetypeRow = row;
+    }
+
+    void ECS::destroyEntityRow(Entity *entity){
+        Archetype *archetype = &archetypeManager.archetypes.at(entity->archetype);
+
+        for(std::size_t i = 0; i < archetype->columns.size(); i++){
+            destroyColumnComponent(archetype->columns.at(i), getColumnData(archetype, i, entity->archetypeRow));
+        }
+
+        removeArchetypeRow(archetype, entity->archetypeRow);
+    }
+
+    void ECS::clearArchetypes(){
+        for(Archetype &archetype : archetypeManager.archetypes){
+            // Stable components are only destroyed here, their pools are reset after
+            forEachArchetypeRow(archetype, [&archetype](uint8_t *chunk, std::size_t chunkRow){
+                for(const ArchetypeColumn &column : archetype.columns){
+                    void *data = chunk + column.offset + chunkRow * column.size;
+                    if(column.isStable){
+                        column.destroyComponentFunc(*static_cast<void**>(data));
+                    }else if(!column.isShared){
+                        column.destroyComponentFunc(data);
+                    }
+                }
+            });
+
+            archetype.chunks.clear();
+            archetype.chunkChangeTicks.clear();
+            archetype.borrowedChunkCount = 0;
+            archetype.size = 0;
+            archetype.version = nextArchetypeVersion();
+        }
+
+        // Every chunk is given back to the pool at once
+        archetypeManager.chunkPool.reset();
+        for(std::unique_ptr<ChunkPool> &stablePool : componentManager.stablePools){
+            if(stablePool != nullptr){
+                stablePool->reset();
+            }
+        }
+
+    #if defined(__unix__) || defined(__APPLE__)
+        for(const MappedSnapshot &mappedSnapshot : archetypeManager.mappedSnapshots){
+            munmap(mappedSnapshot.data, mappedSnapshot.size);
+        }
+    #endif
+        archetypeManager.mappedSnapshots.clear();
+    }
+
+    void* ECS::getColumnData(Archetype *archetype, std::size_t columnIndex, std::size_t row){
+        uint8_t *chunk = archetype->chunks[row / archetype->chunkCapacity];
+        const ArchetypeColumn &column = archetype->columns[columnIndex];
+        return chunk + column.offset + (row % archetype->chunkCapacity) * column.size;
+    }
+
+    void* ECS::getColumnComponentData(Archetype *archetype, std::size_t columnIndex, std::size_t row){
+        void *data = getColumnData(archetype, columnIndex, row);
+        return archetype->columns[columnIndex].isStable ? *static_cast<void**>(data) : data;
+    }
+
+    void* ECS::createColumnComponent(Archetype *archetype, std::size_t columnIndex, std::size_t row){
+        void *data = getColumnData(archetype, columnIndex, row);
+
+        const ArchetypeColumn &column = archetype->columns[columnIndex];
+        if(!column.isStable){
+            return data;
+        }
+
+        const ComponentType &componentType = componentManager.componentTypes[column.typeId];
+        void *component = componentManager.stablePools[column.typeId]->allocate(componentType.size, componentType.alignment);
+        *static_cast<void**>(data) = component;
+        return component;
+    }
+
+    void ECS::moveColumnComponent(const ArchetypeColumn &column, void *destination, void *source){
+        // Shared and stable columns only move the owner or the pointer
+        if(column.isShared || column.isStable){
+            std::memcpy(destination, source, column.size);
+        }else{
+            column.moveComponentFunc(destination, source);
+        }
+    }
+
+    void ECS::destroyColumnComponent(const ArchetypeColumn &column, void *data){
+        if(column.isShared){
+            return;
+        }
+        if(!column.isStable){
+            column.destroyComponentFunc(data);
+            return;
+        }
+
+        void *component = *static_cast<void**>(data);
+        column.destroyComponentFunc(component);
+
+        const ComponentType &componentType = componentManager.componentTypes[column.typeId];
+        componentManager.stablePools[column.typeId]->deallocate(component, componentType.size, componentType.alignment);
+    }
+
+    EntityID* ECS::getRowEntityID(Archetype *archetype, std::size_t row){
+        uint8_t *chunk = archetype->chunks[row / archetype->chunkCapacity];
+        return reinterpret_cast<EntityID*>(chunk) + row % archetype->chunkCapacity;
+    }
+
+    ComponentTicks* ECS::getColumnTicks(Archetype *archetype, std::size_t columnIndex, std::size_t row){
+        uint8_t *chunk = archetype->chunks[row / archetype->chunkCapacity];
+        return reinterpret_cast<ComponentTicks*>(chunk + archetype->columns[columnIndex].tickOffset) + row % archetype->chunkCapacity;
+    }
+
+    ComponentTicks ECS::getColumnComponentTicks(const ArchetypeColumn &column, uint8_t *chunk, std::size_t chunkRow){
+        ComponentTicks ticks = reinterpret_cast<ComponentTicks*>(chunk + column.tickOffset)[chunkRow];
+
+        // A shared component changes when it is shared with the entity or when its owner changes it
+        if(column.isShared){
+            ComponentTicks *ownerTicks;
+            getComponent(getEntity(reinterpret_cast<EntityID*>(chunk + column.offset)[chunkRow]), column.typeId, &ownerTicks);
+            ticks.changed = std::max(ticks.changed, ownerTicks->changed);
+        }
+        return ticks;
+    }
+
+    void ECS::stampColumn(Archetype *archetype, std::size_t columnIndex, std::size_t row){
+        *getColumnTicks(archetype, columnIndex, row) = {changeManager.tick, changeManager.tick};
+        raiseChunkChangeTick(archetype, getChunkChangeTickIndex(archetype, columnIndex, row), changeManager.tick);
+    }
+
+    void ECS::setColumnChanged(Archetype *archetype, std::size_t columnIndex, std::size_t row, uint32_t tick){
+        getColumnTicks(archetype, columnIndex, row)->changed = tick;
+        raiseChunkChangeTick(archetype, getChunkChangeTickIndex(archetype, columnIndex, row), tick);
+    }
+
+    void ECS::markComponentChanged(Entity *entity, TypeID typeId, uint32_t tick){
+        Archetype *archetype = &archetypeManager.archetypes.at(entity->archetype);
+        std::size_t columnIndex = getColumnIndex(archetype, typeId);
+
+        // The value of a shared component is changed in its owner
+        if(archetype->columns.at(columnIndex).isShared){
+            markComponentChanged(getEntity(*static_cast<EntityID*>(getColumnData(archetype, columnIndex, entity->archetypeRow))), typeId, tick);
+            return;
+        }
+        setColumnChanged(archetype, columnIndex, entity->archetypeRow, tick);
+    }
+
+    std::size_t ECS::getChunkChangeTickIndex(Archetype *archetype, std::size_t columnIndex, std::size_t row){
+        return row / archetype->chunkCapacity * archetype->columns.size() + columnIndex;
+    }
+
+    void ECS::raiseChunkChangeTick(Archetype *archetype, std::size_t changeTickIndex, uint32_t tick){
+        std::atomic<uint32_t> &changeTick = archetype->chunkChangeTicks[changeTickIndex].tick;
+
+        uint32_t current = changeTick.load(std::memory_order_relaxed);
+        while(current < tick && !changeTick.compare_exchange_weak(current, tick, std::memory_order_relaxed)){}
+    }
+
+    void ECS::resizeChunkChangeTicks(Archetype *archetype){
+        archetype->chunkChangeTicks.resize(archetype->chunks.size() * archetype->columns.size());
+    }
+
+    void ECS::updateChunkChangeTicks(Archetype *archetype){
+        archetype->chunkChangeTicks.clear();
+        resizeChunkChangeTicks(archetype);
+
+        for(std::size_t row = 0; row < archetype->size; row++){
+            for(std::size_t columnIndex = 0; columnIndex < archetype->columns.size(); columnIndex++){
+                raiseChunkChangeTick(archetype, getChunkChangeTickIndex(archetype, columnIndex, row), getColumnTicks(archetype, columnIndex, row)->changed);
+            }
+        }
+    }
+
+    uint32_t ECS::getChangeTick(){
+        return changeManager.tick;
+    }
+
+    uint32_t ECS::advanceChangeTick(){
+        return changeManager.tick++;
+    }
+
+    void ECS::clearRemovals(uint32_t tick){
+        auto isSeen = [tick](const auto &removal){ return removal.tick <= tick; };
+
+        auto &removedComponents = changeManager.removedComponents;
+        removedComponents.erase(removedComponents.begin(), std::partition_point(removedComponents.begin(), removedComponents.end(), isSeen));
+
+        auto &removedEntities = changeManager.removedEntities;
+        removedEntities.erase(removedEntities.begin(), std::partition_point(removedEntities.begin(), removedEntities.end(), isSeen));
+    }
+
+    CommandBuffer& ECS::getCommandBuffer(){
+        std::lock_guard<std::mutex> lock(commandBufferManager.mutex);
+
+        if(commandBufferManager.isFlushing){
+            std::cerr << "ERROR: can't record commands while the commands are being flushed\n";
+            throw std::exception();
+        }
+
+        std::thread::id threadId = std::this_thread::get_id();
+        auto it = commandBufferManager.threadsToCommandBuffers.find(threadId);
+        if(it != commandBufferManager.threadsToCommandBuffers.end()){
+            return *commandBufferManager.commandBuffers.at(it->second);
+        }
+
+        commandBufferManager.threadsToCommandBuffers[threadId] = commandBufferManager.commandBuffers.size();
+        commandBufferManager.commandBuffers.push_back(std::make_unique<CommandBuffer>());
+        return *commandBufferManager.commandBuffers.back();
+    }
+
+    void ECS::flushCommands(){
+        {
+            std::lock_guard<std::mutex> lock(commandBufferManager.mutex);
+            commandBufferManager.isFlushing = true;
+        }
+
+        // Clears the buffers and allows recording again even if a command throws
+        struct FlushGuard {
+            CommandBufferManager &commandBufferManager;
+            ~FlushGuard(){
+                std::lock_guard<std::mutex> lock(commandBufferManager.mutex);
+                for(std::unique_ptr<CommandBuffer> &commandBuffer : commandBufferManager.commandBuffers){
+                    commandBuffer->clear();
+                }
+                commandBufferManager.isFlushing = false;
+            }
+        } flushGuard{commandBufferManager};
+
+        std::vector<std::pair<EntityID, const CommandBuffer::Command*>> componentCommands;
+        std::vector<EntityID> entitiesToRemove;
+
+        // Buffers are flushed in the order they were created so flushing is deterministic
+        for(std::unique_ptr<CommandBuffer> &commandBuffer : commandBufferManager.commandBuffers){
+            std::vector<EntityID> newEntities(commandBuffer->newEntityCount);
+            for(std::size_t i = 0; i < newEntities.size(); i++){
+                addEntity(newEntities.at(i));
+            }
+
+            for(const CommandBuffer::Command &command : commandBuffer->commands){
+                EntityID entityID = command.isNewEntity ? newEntities.at(command.entityID) : command.entityID;
+
+                if(command.type == CommandBuffer::CommandType::RemoveEntity){
+                    entitiesToRemove.push_back(entityID);
+                }else{
+                    componentCommands.push_back({entityID, &command});
+                }
+            }
+        }
+
+        // Grouping by type keeps each type's storage and archetype edges hot, the order of each type's commands is kept
+        std::stable_sort(componentCommands.begin(), componentCommands.end(), [](const auto &command1, const auto &command2){
+            return command1.second->typeId < command2.second->typeId;
+        });
+
+        for(const auto &[entityID, command] : componentCommands){
+            if(isEntityValid(entityID) == false){continue;}
+
+            if(command->type == CommandBuffer::CommandType::AddComponent){
+                command->addComponentFunc(*this, entityID, command->component);
+            }else if(componentTypeExists(command->typeId) && hasComponent(getEntity(entityID), command->typeId)){
+                removeComponent(entityID, command->typeId);
+            }
+        }
+
+        for(EntityID entityID : entitiesToRemove){
+            if(isEntityValid(entityID)){
+                removeEntity(entityID);
+            }
+        }
+    }
+
+    void ECS::setJobSystem(JobSystem &jobSystem){
+        this->jobSystem = &jobSystem;
+    }
+
+    void ECS::setAllocator(Allocator &allocator){
+        archetypeManager.chunkPool.setAllocator(allocator);
+        for(std::unique_ptr<ChunkPool> &stablePool : componentManager.stablePools){
+            if(stablePool != nullptr){
+                stablePool->setAllocator(allocator);
+            }
+        }
+        this->allocator = &allocator;
+    }
+
+    Allocator& ECS::getAllocator(){
+        if(allocator == nullptr){
+            return Allocator::getDefault();
+        }
+        return *allocator;
+    }
+
+    JobSystem& ECS::getJobSystem(){
+        if(jobSystem == nullptr){
+            return JobSystem::getDefault();
+        }
+        return *jobSystem;
+    }
+
+    TypeID ECS::nextTypeID(){
+        static std::atomic<TypeID> s_NextTypeID(0);
+        return s_NextTypeID++;
+    }
+
+    uint64_t ECS::nextArchetypeVersion(){
+        // Versions start at 1 so an unresolved reference never matches
+        static std::atomic<uint64_t> s_NextArchetypeVersion(1);
+        return s_NextArchetypeVersion++;
+    }
+
+    TypeID ECS::getTypeID(std::string typeName){
+        auto it = componentManager.typeNamesToTypeIds.find(typeName);
+        if(it == componentManager.typeNamesToTypeIds.end()){
+            std::cerr << "ERROR: No component with name '" << typeName << "'\n";
+            throw std::exception();
+        }
+        return it->second;
+    }
+
+    void ECS::displayECS(){
+        std::cout << "Component Types" << "\n" << "===============" << "\n";
+
+        for (TypeID typeId = 0; typeId < componentManager.componentTypes.size(); typeId++) {
+            if(!componentManager.componentTypes[typeId].isRegistered){continue;}
+            std::string name = componentManager.componentTypes[typeId].name;
+            int count = countEntitiesWithComponent(typeId);
+
+            std::cout <<  name << "\n   count: " << count << "\n";
+        }
+        std::cout <<  "\n";
+
+        std::cout << "Archetypes" << "\n" << "==========" << "\n";
+
+        for (std::size_t i = 0; i < archetypeManager.archetypes.size(); i++) {
+            const Archetype &archetype = archetypeManager.archetypes.at(i);
+
+            std::cout << "ID: " << i << "\n   components: ";
+            for(const ArchetypeColumn &column : archetype.columns){
+                std::cout << componentManager.componentTypes.at(column.typeId).name << (column.isShared ? " (shared)" : "") << " ";
+            }
+            std::cout << "\n   count: " << archetype.size 
+                        << "\n   chunks: " << archetype.chunks.size() << " (capacity: " << archetype.chunkCapacity << ")"
+                        << "\n";
+        }
+        std::cout <<  "\n";
+
+        std::cout << "Entities" << "\n" << "========" << "\n";
 
         std::cout << "tombstone entities: ";
-        for(int i = 0; i < entityManager.tombstoneEntities.size(); i++){
+        for(std::size_t i = 0; i < entityManager.tombstoneEntities.size(); i++){
             std::cout << entityManager.tombstoneEntities.at(i) << ", ";
         }
         std::cout <<  "\n";
 
         forEachEntity([this](EntityID &entityId){ 
-            Entity entity = this->entityManager.entities.at(entityId);
+            Entity &entity = *getEntity(entityId);
             std::cout << "ID: " << entityId;
             if(entity.entityGUID > 0){std::cout << "  GUID: " << entity.entityGUID;}
             if(entity.parentEntity < (std::size_t)-1){std::cout << " parentEntity: " << entity.parentEntity;}
+            std::cout << "  archetype: " << entity.archetype << ", row: " << entity.archetypeRow;
             std::cout <<  "\n";
-            entity.components.forEach([this, entityId](std::size_t key, Component value){
-                std::cout << "  " << this->componentManager.componentTypes.at(key).name 
-                            << ", index: " << value.componentIndex;
-                if(value.parent != entityId){std::cout << ", parent: " << value.parent;}
+            Archetype *archetype = &this->archetypeManager.archetypes.at(entity.archetype);
+            for(std::size_t i = 0; i < archetype->columns.size(); i++){
+                const ArchetypeColumn &column = archetype->columns.at(i);
+                std::cout << "  " << this->componentManager.componentTypes.at(column.typeId).name;
+                if(column.isShared){std::cout << ", parent: " << *static_cast<EntityID*>(getColumnData(archetype, i, entity.archetypeRow));}
                 std::cout <<  "\n";
-            });
+            }
             std::cout <<  "\n";
         });
     }
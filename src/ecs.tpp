@@ -5,6 +5,10 @@
     #include <cxxabi.h>
 #endif
 #include <iostream>
+#include <cstring>
+#include <new>
+#include <tuple>
+#include <type_traits>
 
 namespace BasicECS{
     template <typename T> static std::string getTypeName() {
@@ -22,45 +26,109 @@ namespace BasicECS{
         return typeName;
     }
 
+    // How a query term matches archetypes by its components
+    enum class QueryTermMatch { Required, Optional, Excluded, AnyOf };
+
+    // The component a query term reads, the arguments it passes to the routine, the archetypes it matches and the rows it matches
+    template <typename T> struct QueryTerm{
+        using Component = T;
+        using Arguments = std::tuple<T&>;
+        static constexpr QueryTermMatch match = QueryTermMatch::Required;
+        static constexpr bool isFiltered = false;
+        static bool isMatch(const ComponentTicks &ticks, uint32_t sinceTick){ return true; }
+        static ComponentSignature getComponents(){ return ComponentSignature().set(ECS::getTypeID<T>()); }
+    };
+    template <typename T> struct QueryTerm<Added<T>> : QueryTerm<T>{
+        static constexpr bool isFiltered = true;
+        static bool isMatch(const ComponentTicks &ticks, uint32_t sinceTick){ return ticks.added > sinceTick; }
+    };
+    template <typename T> struct QueryTerm<Changed<T>> : QueryTerm<T>{
+        static constexpr bool isFiltered = true;
+        static bool isMatch(const ComponentTicks &ticks, uint32_t sinceTick){ return ticks.changed > sinceTick; }
+    };
+    template <typename T> struct QueryTerm<Optional<T>> : QueryTerm<T>{
+        using Arguments = std::tuple<T*>;
+        static constexpr QueryTermMatch match = QueryTermMatch::Optional;
+    };
+    template <typename T> struct QueryTerm<Without<T>> : QueryTerm<T>{
+        using Arguments = std::tuple<>;
+        static constexpr QueryTermMatch match = QueryTermMatch::Excluded;
+    };
+    template <typename... Ts> struct QueryTerm<AnyOf<Ts...>>{
+        using Component = void;
+        using Arguments = std::tuple<>;
+        static constexpr QueryTermMatch match = QueryTermMatch::AnyOf;
+        static constexpr bool isFiltered = false;
+        static bool isMatch(const ComponentTicks &ticks, uint32_t sinceTick){ return true; }
+        static ComponentSignature getComponents(){ return (QueryTerm<Ts>::getComponents() | ...); }
+    };
+    // Terms with a column the rows are read from, it's missing from some archetypes for optional terms
+    template <typename T> constexpr bool hasQueryColumn = QueryTerm<T>::match == QueryTermMatch::Required || QueryTerm<T>::match == QueryTermMatch::Optional;
+
+    template <typename Func, typename Arguments, typename... Extra> struct IsQueryRoutine;
+    template <typename Func, typename... Arguments, typename... Extra> struct IsQueryRoutine<Func, std::tuple<Arguments...>, Extra...> : std::is_invocable<Func&, Arguments..., Extra...> {};
+
     template <typename T>  TypeID ECS::getTypeID(){
-        return typeid(T).hash_code();
+        // Const types are the same component type, they only give read access
+        if constexpr(std::is_const_v<T>){
+            return getTypeID<std::remove_const_t<T>>();
+        }else{
+            static const TypeID typeId = nextTypeID();
+            return typeId;
+        }
     }
 
-    template <typename T> static std::vector<uint8_t> serializeTrivialComponent(ECS &ecs, EntityID entity){
-        std::vector<uint8_t> serializedData;
-
-        T& component = ecs.getComponent<T>(entity);
-        uint8_t* componentData = reinterpret_cast<uint8_t*>(&component);
-        serializedData.insert(serializedData.end(), componentData, componentData + sizeof(T));
-
-        return serializedData;
+    template <typename T> static void serializeTrivialComponent(ECS &ecs, EntityID entity, Writer &writer){
+        writer.write(ecs.getComponent<const T>(entity));
     }
 
-    template <typename T> static void deserializeTrivialComponent(ECS &ecs, EntityID entity, const std::vector<uint8_t> data){
-        T component;
-
-        // Check if data size matches the expected size for the component type
-        if (data.size() != sizeof(T)) {
-            throw std::runtime_error("Invalid data size for component deserialization.");
-        }
+    template <typename T> static void deserializeTrivialComponent(ECS &ecs, EntityID entity, Reader &reader){
+        // Add the component to the entity in ECS
+        ecs.addComponent(entity, reader.read<T>());
+    }
 
-        // Copy the data into the component's memory
-        std::memcpy(&component, data.data(), sizeof(T));
+    template <typename T> void moveComponent_(void *destination, void *source){
+        T *component = static_cast<T*>(source);
+        new (destination) T(std::move(*component));
+        component->~T();
+    }
 
-        // Add the component to the entity in ECS
-        ecs.addComponent(entity, component);
+    template <typename T> void destroyComponent_(void *component){
+        static_cast<T*>(component)->~T();
     }
 
-    template <typename T> void removeComponentType_(ECS &ecs){
-        ecs.removeComponentType<T>();
+    template <typename T> void copyComponent_(void *destination, const void *source){
+        new (destination) T(*static_cast<const T*>(source));
     }
 
-    template <typename T> void pruneComponentList_(ECS &ecs){
-        ecs.pruneComponentList<T>();
+    template <typename T, typename = void> struct HasHash : std::false_type {};
+    template <typename T> struct HasHash<T, std::void_t<decltype(std::hash<T>{}(std::declval<const T&>()))>> : std::true_type {};
+    template <typename T, typename = void> struct HasEquality : std::false_type {};
+    template <typename T> struct HasEquality<T, std::void_t<decltype(std::declval<const T&>() == std::declval<const T&>())>> : std::true_type {};
+
+    // Shared values are compared with operator== and std::hash, or by their bytes when every byte is part of the value
+    template <typename T> constexpr bool isSharedValueComparable = (HasHash<T>::value && HasEquality<T>::value) || std::has_unique_object_representations_v<T>;
+
+    template <typename T> std::size_t hashSharedValue(const T &value){
+        if constexpr(HasHash<T>::value && HasEquality<T>::value){
+            return std::hash<T>{}(value);
+        }else{
+            // FNV-1a
+            const uint8_t *bytes = reinterpret_cast<const uint8_t*>(&value);
+            uint64_t hash = 14695981039346656037ull;
+            for(std::size_t i = 0; i < sizeof(T); i++){
+                hash = (hash ^ bytes[i]) * 1099511628211ull;
+            }
+            return hash;
+        }
     }
 
-    template <typename T> void clearComponentList_(ECS &ecs){
-        ecs.clearComponentList<T>();
+    template <typename T> bool isSharedValueEqual(const T &a, const T &b){
+        if constexpr(HasHash<T>::value && HasEquality<T>::value){
+            return a == b;
+        }else{
+            return std::memcmp(&a, &b, sizeof(T)) == 0;
+        }
     }
 
     template <typename T> Reference<T> ECS::createReference(EntityID entityId){
@@ -72,23 +140,32 @@ namespace BasicECS{
         std::string name = getTypeName<T>();
 
         ComponentType componentType = {
-            .arrayLocation = new std::vector<T>(),
-            .entitiesUsingThis = {},
-            .tombstoneComponents = {},
+            .isRegistered = true,
+            .isTrivial = std::is_trivially_copyable<T>(),
+            .isStable = componentFunctions.isStable,
+            .size = sizeof(T),
+            .alignment = alignof(T),
             .initialiseFunc = componentFunctions.initialiseFunc,
             .deinitializeFunc = componentFunctions.deinitializeFunc,
-            .removeComponentTypeFunc = removeComponentType_<T>,
-            .pruneComponentListFunc = pruneComponentList_<T>,
-            .clearComponentListFunc = clearComponentList_<T>,
+            .moveComponentFunc = moveComponent_<T>,
+            .destroyComponentFunc = destroyComponent_<T>,
+            .copyComponentFunc = nullptr,
             .name = name
         };
 
-        bool isTrivial = std::is_trivially_copyable<T>();
+        if constexpr(std::is_copy_constructible_v<T>){
+            componentType.copyComponentFunc = copyComponent_<T>;
+        }
+
+        if(typeID >= MaxComponentTypes){
+            std::cerr << "ERROR: can't add component type '" << name << "', the maximum is " << MaxComponentTypes << " component types\n";
+            throw std::exception();
+        }
 
         if(componentFunctions.serializeFunc != nullptr){
             componentType.serializeFunc = componentFunctions.serializeFunc;
         }else{
-            if(isTrivial){
+            if constexpr(std::is_trivially_copyable<T>()){
                 componentType.serializeFunc = serializeTrivialComponent<T>;
             }else{
                 std::cout << "WARNING: Not trivial component '" << name << "' doesn't have serialize function\n";
@@ -99,7 +176,7 @@ namespace BasicECS{
         if(componentFunctions.deserializeFunc != nullptr){
             componentType.deserializeFunc = componentFunctions.deserializeFunc;
         }else{
-            if(isTrivial){
+            if constexpr(std::is_trivially_copyable<T>()){
                 componentType.deserializeFunc = deserializeTrivialComponent<T>;
             }else{
                 std::cout << "WARNING: Not trivial component '" << name << "' doesn't have deserialize function\n";
@@ -107,54 +184,162 @@ namespace BasicECS{
             }
         }
         
+        if(typeID >= componentManager.componentTypes.size()){
+            componentManager.componentTypes.resize(typeID + 1);
+        }
         componentManager.componentTypes[typeID] = componentType;
         componentManager.typeNamesToTypeIds[name] = typeID;
+
+        if(typeID >= componentManager.stablePools.size()){
+            componentManager.stablePools.resize(typeID + 1);
+        }
+        if(componentType.isStable && componentManager.stablePools[typeID] == nullptr){
+            // Pages of about one archetype chunk each
+            componentManager.stablePools[typeID] = std::make_unique<ChunkPool>(sizeof(T), alignof(T), std::max<std::size_t>(1, ArchetypeChunkSize / sizeof(T)));
+            componentManager.stablePools[typeID]->setAllocator(getAllocator());
+        }
     }
 
     template <typename T> void ECS::removeComponentType(){
         TypeID typeId = getTypeID<T>();
-        auto it = componentManager.componentTypes.find(typeId);
-        if(it != componentManager.componentTypes.end()){
-            runAllComponentDeinitializes(&it->second, typeId);
-            delete static_cast<std::vector<T>*>(it->second.arrayLocation);
+        if(componentTypeExists(typeId) == false){return;}
+
+        // Sharers go first so shared values are removed with them and owners have no sharers left
+        std::vector<EntityID> sharingEntities = getEntitiesWithComponent(typeId, true);
+        for(EntityID entityID : sharingEntities){
+            if(archetypeManager.archetypes[getEntity(entityID)->archetype].signature.sharedComponents.test(typeId)){
+                removeComponent(entityID, typeId);
+            }
+        }
+        std::vector<EntityID> entitiesUsingThis = getEntitiesWithComponent(typeId, false);
+        for(std::size_t i = 0; i < entitiesUsingThis.size(); i++){
+            removeComponent(entitiesUsingThis.at(i), typeId);
+        }
+
+        // The type can be added again with another layout, so nothing may keep the columns of this one
+        retireArchetypes(typeId);
+
+        componentManager.typeNamesToTypeIds.erase(getComponentType(typeId)->name);
+        componentManager.componentTypes[typeId] = ComponentType{};
+        componentManager.stablePools[typeId] = nullptr;
+    }
+
+    template <typename T> void ECS::registerComponentType(){
+        if(componentTypeExists(getTypeID<T>()) == false){
+            addComponentType<T>({});
         }
     }
 
-    template <typename T> ECS& ECS::addComponent(EntityID entityID, T t){
+    template <typename... Ts> std::vector<EntityID> ECS::createEntities(std::size_t count, const Ts&... components){
+        (registerComponentType<Ts>(), ...);
+
+        ArchetypeSignature signature;
+        (signature.components.set(getTypeID<Ts>()), ...);
+
+        if(signature.components.count() != sizeof...(Ts)){
+            std::cerr << "ERROR: can't create entities with the same component type twice\n";
+            throw std::exception();
+        }
+
+        std::size_t archetypeIndex = getArchetype(signature);
+        std::vector<EntityID> entityIDs = addEntities(count, archetypeIndex);
+
+        [[maybe_unused]] Archetype *archetype = &archetypeManager.archetypes.at(archetypeIndex);
+        [[maybe_unused]] std::size_t columnIndexes[] = {getColumnIndex(archetype, getTypeID<Ts>())..., 0};
+
+        // The new rows are at the end of the archetype so they are filled in order
+        for(EntityID entityID : entityIDs){
+            [[maybe_unused]] std::size_t row = getEntity(entityID)->archetypeRow;
+            [[maybe_unused]] std::size_t i = 0;
+            (new (createColumnComponent(archetype, columnIndexes[i++], row)) Ts(components), ...);
+
+            for(std::size_t columnIndex = 0; columnIndex < archetype->columns.size(); columnIndex++){
+                stampColumn(archetype, columnIndex, row);
+            }
+        }
+
+        TypeID typeIds[] = {getTypeID<Ts>()..., 0};
+        for(std::size_t i = 0; i < sizeof...(Ts); i++){
+            InitialiseFunc initialiseFunc = getComponentType(typeIds[i])->initialiseFunc;
+            if(initialiseFunc == nullptr){continue;}
+
+            for(EntityID entityID : entityIDs){
+                initialiseFunc(*this, entityID);
+            }
+        }
+
+        return entityIDs;
+    }
+
+    template <typename T> ECS& ECS::addComponents(const std::vector<EntityID> &entityIDs, std::vector<T> components){
+        if(entityIDs.size() != components.size()){
+            std::cerr << "ERROR: can't add " << components.size() << " components to " << entityIDs.size() << " entities\n";
+            throw std::exception();
+        }
+
+        registerComponentType<T>();
         TypeID typeId = getTypeID<T>();
 
-        auto componentType_it = componentManager.componentTypes.find(typeId);
-        if(componentType_it == componentManager.componentTypes.end()){
-            addComponentType<T>({});
+        // Entities from the same archetype go to the same archetype, so the destinations are found and reserved first
+        std::vector<std::size_t> destinations(entityIDs.size());
+        std::unordered_map<std::size_t, std::size_t> destinationCounts;
+        std::size_t lastSource = -1;
+        std::size_t lastDestination = 0;
+
+        for(std::size_t i = 0; i < entityIDs.size(); i++){
+            Entity *entity = getEntity(entityIDs[i]);
+            if(hasComponent(entity, typeId)){
+                removeComponent(entityIDs[i], typeId, true);
+                entity = getEntity(entityIDs[i]);
+            }
+
+            if(entity->archetype != lastSource){
+                lastSource = entity->archetype;
+                lastDestination = getArchetypeWith(lastSource, typeId, false);
+            }
+            destinations[i] = lastDestination;
+            destinationCounts[lastDestination]++;
         }
-        ComponentType *componentType = &componentManager.componentTypes.at(typeId);
 
-        Entity *entity = getEntity(entityID);
+        for(const auto &[archetypeIndex, count] : destinationCounts){
+            reserveArchetypeRows(&archetypeManager.archetypes.at(archetypeIndex), count);
+        }
 
-        Component *component = entity->components.get(typeId);
+        for(std::size_t i = 0; i < entityIDs.size(); i++){
+            moveEntity(entityIDs[i], destinations[i]);
 
-        entityManager.cachedEntity = entityID;
-        
-        if(component != nullptr){
-            removeComponent<T>(entityID);
+            Entity *entity = getEntity(entityIDs[i]);
+            Archetype *archetype = &archetypeManager.archetypes.at(entity->archetype);
+            std::size_t columnIndex = getColumnIndex(archetype, typeId);
+            new (createColumnComponent(archetype, columnIndex, entity->archetypeRow)) T(std::move(components[i]));
+            stampColumn(archetype, columnIndex, entity->archetypeRow);
         }
 
-        void* componentArrLocation = componentType->arrayLocation;
-        std::vector<T>* componentArr = static_cast<std::vector<T>*>(componentArrLocation);
+        InitialiseFunc initialiseFunc = getComponentType(typeId)->initialiseFunc;
+        if(initialiseFunc != nullptr){
+            for(EntityID entityID : entityIDs){
+                initialiseFunc(*this, entityID);
+            }
+        }
 
-        if(!componentType->tombstoneComponents.empty()){
-            std::size_t index = componentType->tombstoneComponents.back();
-            componentArr->at(index) = t;
-            componentType->tombstoneComponents.pop_back();
-    
-            entity->components.insert(typeId, {.componentIndex = index, .parent = entityID});
-        }else{
-            componentArr->push_back(t);
+        return *this;
+    }
+
+    template <typename T> ECS& ECS::addComponent(EntityID entityID, T t){
+        TypeID typeId = getTypeID<T>();
+
+        registerComponentType<T>();
+        ComponentType *componentType = getComponentType(typeId);
+
+        Entity *entity = getEntity(entityID);
 
-            entity->components.insert(typeId, {.componentIndex = componentArr->size() - 1, .parent = entityID});
+        entityManager.cachedEntity = entityID;
+        
+        if(hasComponent(entity, typeId)){
+            removeComponent(entityID, typeId, true);
         }
 
-        componentType->entitiesUsingThis.push_back(entityID);
+        new (addComponentStorage(entityID, typeId)) T(std::move(t));
 
         if(componentType->initialiseFunc != nullptr){
             componentType->initialiseFunc(*this, entityID);
@@ -175,30 +360,133 @@ namespace BasicECS{
     template <typename T> ECS& ECS::addComponent(EntityID parentEntityID){
         return addComponent<T>(entityManager.cachedEntity, parentEntityID);
     }
+    template <typename T> ECS& ECS::addSharedComponent(EntityID entityID, T component){
+        registerComponentType<T>();
+        TypeID typeId = getTypeID<T>();
+        getEntity(entityID);
+
+        SharedValues &sharedValues = getSharedValues(typeId);
+        EntityID valueEntityID = RootEntityID;
+        [[maybe_unused]] std::size_t hash = 0;
+
+        if constexpr(isSharedValueComparable<T>){
+            if(!sharedValues.isIndexed){
+                sharedValues.valueEntities.clear();
+                sharedValues.valueHashes.clear();
+                for(EntityID ownerEntityID : getEntitiesWithComponent(typeId, false)){
+                    if(!isSharedValueEntity(ownerEntityID)){continue;}
+
+                    std::size_t ownerHash = hashSharedValue(*static_cast<const T*>(getComponent(getEntity(ownerEntityID), typeId)));
+                    sharedValues.valueEntities.insert({ownerHash, ownerEntityID});
+                    sharedValues.valueHashes[ownerEntityID] = ownerHash;
+                }
+                sharedValues.isIndexed = true;
+            }
+
+            hash = hashSharedValue(component);
+            auto range = sharedValues.valueEntities.equal_range(hash);
+            for(auto it = range.first; it != range.second; it++){
+                if(isSharedValueEqual(*static_cast<const T*>(getComponent(getEntity(it->second), typeId)), component)){
+                    valueEntityID = it->second;
+                    break;
+                }
+            }
+        }
+
+        if(valueEntityID == RootEntityID){
+            new (addSharedValue(valueEntityID, typeId)) T(std::move(component));
+
+            if constexpr(isSharedValueComparable<T>){
+                sharedValues.valueEntities.insert({hash, valueEntityID});
+                sharedValues.valueHashes[valueEntityID] = hash;
+            }
+
+            InitialiseFunc initialiseFunc = getComponentType(typeId)->initialiseFunc;
+            if(initialiseFunc != nullptr){
+                initialiseFunc(*this, valueEntityID);
+            }
+        }
+
+        addComponent(entityID, valueEntityID, typeId);
+
+        return *this;
+    }
+    template <typename T> ECS& ECS::addSharedComponent(T component){
+        return addSharedComponent(entityManager.cachedEntity, std::move(component));
+    }
+    template <typename T> std::size_t ECS::getSharerCount(EntityID entityID){
+        TypeID typeId = getTypeID<T>();
+        EntityID ownerEntityID = getComponentOwner(entityID, typeId);
+        std::size_t sharerCount = getSharerCount(ownerEntityID, typeId);
+
+        // An entity that owns its component is one of the sharers, a shared value entity isn't
+        return isSharedValueEntity(ownerEntityID) ? sharerCount : sharerCount + 1;
+    }
+
     template <typename T> ECS& ECS::removeComponent(EntityID entityID){
         removeComponent(entityID, getTypeID<T>());
         return *this;
     }
 
+    template <typename T> bool ECS::hasComponent(EntityID entityID){
+        TypeID typeId = getTypeID<T>();
+        if(componentTypeExists(typeId) == false){return false;}
+
+        return hasComponent(getEntity(entityID), typeId);
+    }
+
     template <typename T> T& ECS::getComponent(EntityID entityID){
         TypeID typeId = getTypeID<T>();
 
-        ComponentType *componentType = getComponentType(typeId);
+        if constexpr(std::is_const_v<T>){
+            return *static_cast<T*>(getComponent(getEntity(entityID), typeId));
+        }else{
+            ComponentTicks *componentTicks;
+            return *static_cast<T*>(getComponentForWrite(entityID, typeId, &componentTicks));
+        }
+    }
 
-        Component *component = getComponent(getEntity(entityID), typeId);
+    template <typename T> T& ECS::getComponent(const Reference<T> &reference){
+        if(reference.archetype < archetypeManager.archetypes.size() && archetypeManager.archetypes[reference.archetype].version == reference.archetypeVersion){
+            if constexpr(!std::is_const_v<T>){
+                reference.ticks->changed = changeManager.tick;
+                raiseChunkChangeTick(&archetypeManager.archetypes[reference.archetype], reference.changeTickIndex, changeManager.tick);
+            }
+            return *reference.component;
+        }
 
-        if(entityID >= entityManager.entities.size()){
-            std::cerr << "ERROR: component parent does not exist for component '" <<  componentType->name << "'\n";
+        EntityID entityID = getEntityID(reference.entityGUID);
+        ComponentTicks *componentTicks;
+        T *component;
+        if constexpr(std::is_const_v<T>){
+            component = static_cast<T*>(getComponent(getEntity(entityID), reference.typeId, &componentTicks));
+        }else{
+            component = static_cast<T*>(getComponentForWrite(entityID, reference.typeId, &componentTicks));
         }
+        Entity *entity = getEntity(entityID);
 
-        void* componentArrLocation = componentType->arrayLocation;
-        std::vector<T>* componentArr = static_cast<std::vector<T>*>(componentArrLocation);
+        // Shared components live in another entity's archetype so they are resolved every time
+        Archetype *archetype = &archetypeManager.archetypes.at(entity->archetype);
+        std::size_t columnIndex = getColumnIndex(archetype, reference.typeId);
+        if(!archetype->columns.at(columnIndex).isShared){
+            reference.component = component;
+            reference.ticks = componentTicks;
+            reference.changeTickIndex = getChunkChangeTickIndex(archetype, columnIndex, entity->archetypeRow);
+            reference.archetype = entity->archetype;
+            reference.archetypeVersion = archetype->version;
+        }
+
+        return *component;
+    }
 
-        return componentArr->at(component->componentIndex);
+    template <typename T> void ECS::markChanged(EntityID entityID){
+        markComponentChanged(getEntity(entityID), getTypeID<T>(), changeManager.tick);
     }
 
-    template <typename T> T& ECS::getComponent(Reference<T> reference){
-        return getComponent<T>(entityManager.entityGUIDToEntityID.at(reference.entityGUID));
+    template <typename T> ComponentTicks ECS::getComponentTicks(EntityID entityID){
+        ComponentTicks *componentTicks;
+        getComponent(getEntity(entityID), getTypeID<T>(), &componentTicks);
+        return *componentTicks;
     }
 
     template <typename T> T& ECS::getComponent(){
@@ -209,16 +497,31 @@ namespace BasicECS{
 
         ComponentType *componentType = getComponentType(typeId);
 
-        return getComponent<T>(componentType->entitiesUsingThis.at(0));
+        for(Archetype &archetype : archetypeManager.archetypes){
+            if(archetype.signature.components.test(typeId) && !archetype.signature.sharedComponents.test(typeId) && !archetype.signature.isSharedValue && archetype.size > 0){
+                std::size_t columnIndex = *archetype.columnIndexes.get(typeId);
+                if constexpr(!std::is_const_v<T>){
+                    setColumnChanged(&archetype, columnIndex, 0, changeManager.tick);
+                }
+                return *static_cast<T*>(getColumnComponentData(&archetype, columnIndex, 0));
+            }
+        }
+
+        std::cerr << "ERROR: there is no component of type '" << componentType->name << "'\n";
+        throw std::exception();
     }
 
     template <typename T> bool ECS::isSingular(){
         TypeID typeId = getTypeID<T>();
         if(componentTypeExists(typeId) == false){return false;}
-        ComponentType *componentType = getComponentType(typeId);
-        std::vector<T>* componentArr = static_cast<std::vector<T>*>(componentType->arrayLocation);
 
-        int componentAmount = componentArr->size() - componentType->tombstoneComponents.size();
+        std::size_t componentAmount = 0;
+
+        for(Archetype &archetype : archetypeManager.archetypes){
+            if(archetype.signature.components.test(typeId) && !archetype.signature.sharedComponents.test(typeId) && !archetype.signature.isSharedValue){
+                componentAmount += archetype.size;
+            }
+        }
 
         if(componentAmount == 1){
             return true;
@@ -226,126 +529,375 @@ namespace BasicECS{
         return false;
     }
 
-    template <typename T> void ECS::forEach(std::function<void(T &t)> routine){
-        TypeID typeId = getTypeID<T>();
-        if(componentTypeExists(typeId) == false){return;}
-        ComponentType *componentType = getComponentType(typeId);
-        std::vector<T>* componentArr = static_cast<std::vector<T>*>(componentType->arrayLocation);
+    template <typename Func> void ECS::forEachChild(EntityID entityID, Func &&routine){
+        EntityID childEntityID = getEntity(entityID)->firstChildEntity;
+        while(childEntityID != RootEntityID){
+            EntityID nextSiblingEntityID = getEntity(childEntityID)->nextSiblingEntity;
+            routine(childEntityID);
+            childEntityID = nextSiblingEntityID;
+        }
+    }
+
+    template <typename Func> void ECS::forEachInHierarchy(Func &&routine){
+        if(hierarchyManager.isDirty){
+            buildHierarchyOrder();
+        }
 
-        std::size_t currentNextTombstoneIndex = 0;
-        std::size_t currentNextTombstone = 0;
-        if(!componentType->tombstoneComponents.empty()){
-            currentNextTombstone = componentType->tombstoneComponents.at(currentNextTombstoneIndex);
+        const std::vector<HierarchyNode> &nodes = hierarchyManager.nodes;
+        for(const HierarchyNode &node : nodes){
+            routine(node.entityID, node.parentNode == RootEntityID ? RootEntityID : nodes[node.parentNode].entityID);
         }
+    }
+
+    template <typename Source, typename Target, typename Func> void ECS::propagateHierarchy(uint32_t sinceTick, Func &&routine, std::size_t grainSize){
+        static_assert(std::is_invocable_v<Func&, const Source&, const Target*, Target&>, "propagateHierarchy routine must take (const Source&, const Target*, Target&)");
+
+        const TypeID sourceTypeId = getTypeID<Source>();
+        const TypeID targetTypeId = getTypeID<Target>();
+        if(!componentTypeExists(sourceTypeId) || !componentTypeExists(targetTypeId)){return;}
 
+        if(hierarchyManager.isDirty){
+            buildHierarchyOrder();
+        }
 
-        for(std::size_t i = 0; i < componentArr->size(); i++){
-            if(i == currentNextTombstone && currentNextTombstoneIndex < componentType->tombstoneComponents.size()){
-                currentNextTombstoneIndex ++;
-                if(currentNextTombstoneIndex < componentType->tombstoneComponents.size()){
-                    currentNextTombstone = componentType->tombstoneComponents.at(currentNextTombstoneIndex);
+        grainSize = std::max<std::size_t>(grainSize, 1);
+
+        const std::vector<HierarchyNode> &nodes = hierarchyManager.nodes;
+        const std::vector<std::size_t> &levelOffsets = hierarchyManager.levelOffsets;
+        const uint32_t tick = changeManager.tick;
+
+        // The nodes that changed themselves, sorted by node so each level is a contiguous range of them
+        std::vector<std::size_t> seedNodes;
+        std::vector<std::size_t> changedNodes;
+        getHierarchySeeds(sourceTypeId, targetTypeId, sinceTick, seedNodes, changedNodes);
+
+        std::vector<std::size_t> levelNodes;
+        std::vector<std::size_t> childNodes;
+        std::vector<std::size_t> parentNodes;
+        std::vector<uint8_t> isWritten;
+        auto seedBegin = seedNodes.begin();
+        auto changedBegin = changedNodes.begin();
+
+        for(std::size_t level = 0; level + 1 < levelOffsets.size(); level++){
+            const std::size_t levelEnd = levelOffsets[level + 1];
+
+            // A level visits its own seeds and the children of the Targets that changed on the level above it
+            auto seedEnd = std::lower_bound(seedBegin, seedNodes.end(), levelEnd);
+            levelNodes.clear();
+            std::set_union(seedBegin, seedEnd, childNodes.begin(), childNodes.end(), std::back_inserter(levelNodes));
+            seedBegin = seedEnd;
+
+            isWritten.assign(levelNodes.size(), 0);
+
+            // A level only reads the targets of the level above it, which is finished before it starts
+            getJobSystem().run((levelNodes.size() + grainSize - 1) / grainSize, [&](std::size_t jobIndex){
+                const std::size_t begin = jobIndex * grainSize;
+                const std::size_t end = std::min(begin + grainSize, levelNodes.size());
+
+                for(std::size_t i = begin; i < end; i++){
+                    const HierarchyNode &node = nodes[levelNodes[i]];
+                    Entity *entity = getEntity(node.entityID);
+                    const ArchetypeSignature &signature = archetypeManager.archetypes[entity->archetype].signature;
+
+                    if(!signature.components.test(sourceTypeId) || !signature.components.test(targetTypeId) || signature.sharedComponents.test(targetTypeId)){continue;}
+
+                    const Source *source = static_cast<const Source*>(getComponent(entity, sourceTypeId));
+                    Target *target = static_cast<Target*>(getComponent(entity, targetTypeId));
+
+                    const Target *parentTarget = nullptr;
+                    if(node.parentNode != RootEntityID){
+                        Entity *parentEntity = getEntity(nodes[node.parentNode].entityID);
+                        if(hasComponent(parentEntity, targetTypeId)){
+                            parentTarget = static_cast<const Target*>(getComponent(parentEntity, targetTypeId));
+                        }
+                    }
+
+                    routine(*source, parentTarget, *target);
+                    markComponentChanged(entity, targetTypeId, tick);
+                    isWritten[i] = 1;
+                }
+            });
+
+            // Subtrees whose root didn't change are never visited
+            auto changedEnd = std::lower_bound(changedBegin, changedNodes.end(), levelEnd);
+            parentNodes.clear();
+            for(std::size_t i = 0; i < levelNodes.size(); i++){
+                if(isWritten[i]){
+                    parentNodes.push_back(levelNodes[i]);
+                }
+            }
+            std::size_t writtenCount = parentNodes.size();
+            parentNodes.insert(parentNodes.end(), changedBegin, changedEnd);
+            std::inplace_merge(parentNodes.begin(), parentNodes.begin() + writtenCount, parentNodes.end());
+            changedBegin = changedEnd;
+
+            childNodes.clear();
+            for(std::size_t i = 0; i < parentNodes.size(); i++){
+                if(i > 0 && parentNodes[i] == parentNodes[i - 1]){continue;}
+                for(std::size_t child = nodes[parentNodes[i]].childBegin; child < nodes[parentNodes[i]].childEnd; child++){
+                    childNodes.push_back(child);
                 }
-            }else{
-                routine(componentArr->at(i));
             }
         }
     }
-    template <typename T> void ECS::forEach(std::function<void(T &t, EntityID entityID)> routine){
-        TypeID typeId = getTypeID<T>();
-        if(componentTypeExists(typeId) == false){return;}
-        ComponentType *componentType = getComponentType(typeId);
-        std::vector<T>* componentArr = static_cast<std::vector<T>*>(componentType->arrayLocation);
 
-        for(std::size_t i = 0; i < componentType->entitiesUsingThis.size(); i++){
-            EntityID entityID = componentType->entitiesUsingThis.at(i);
-            Entity *entity = &entityManager.entities.at(entityID);
+    template <typename Func> void ECS::forEachArchetypeChunk(Archetype &archetype, Func routine){
+        for(std::size_t chunkIndex = 0; chunkIndex < archetype.chunks.size(); chunkIndex++){
+            std::size_t firstRow = chunkIndex * archetype.chunkCapacity;
+            std::size_t rowCount = std::min(archetype.chunkCapacity, archetype.size - firstRow);
 
-            Component *component = entity->components.get(typeId);
-            routine(componentArr->at(component->componentIndex), entityID);
+            routine(archetype.chunks[chunkIndex], rowCount);
         }
     }
 
-    template <typename T1, typename T2> void ECS::forEach(std::function<void(T1 &t1, T2 &t2)> routine){
-        TypeID typeId1 = getTypeID<T1>();
-        if(componentTypeExists(typeId1) == false){return;}
-        ComponentType *componentType1 = getComponentType(typeId1);
-        std::vector<T1>* component1Arr = static_cast<std::vector<T1>*>(componentType1->arrayLocation);
+    template <typename Func> void ECS::forEachRowRange(Archetype &archetype, std::size_t firstRow, std::size_t rowCount, Func routine){
+        std::size_t row = firstRow;
+        std::size_t endRow = firstRow + rowCount;
 
-        TypeID typeId2 = getTypeID<T2>();
-        if(componentTypeExists(typeId2) == false){return;}
-        ComponentType *componentType2 = getComponentType(typeId2);
-        std::vector<T2>* component2Arr = static_cast<std::vector<T2>*>(componentType2->arrayLocation);
+        while(row < endRow){
+            std::size_t chunkRow = row % archetype.chunkCapacity;
+            std::size_t count = std::min(archetype.chunkCapacity - chunkRow, endRow - row);
 
-        for(std::size_t i = 0; i < componentType1->entitiesUsingThis.size(); i++){
+            routine(archetype.chunks[row / archetype.chunkCapacity], chunkRow, count);
+            row += count;
+        }
+    }
 
-            EntityID entityID = componentType1->entitiesUsingThis.at(i);
-            Entity *entity = &entityManager.entities.at(entityID);
+    template <typename Func> void ECS::forEachArchetypeRow(Archetype &archetype, Func routine){
+        forEachArchetypeChunk(archetype, [&routine](uint8_t *chunk, std::size_t rowCount){
+            for(std::size_t i = 0; i < rowCount; i++){
+                routine(chunk, i);
+            }
+        });
+    }
 
-            Component *component2 = entity->components.get(typeId2);
+    template <typename T> T& ECS::getColumnComponent(const ArchetypeColumn &column, uint8_t *chunk, std::size_t chunkRow){
+        if(column.isShared){
+            EntityID ownerEntityID = reinterpret_cast<EntityID*>(chunk + column.offset)[chunkRow];
+            return *static_cast<T*>(getComponent(getEntity(ownerEntityID), column.typeId));
+        }
+        if(column.isStable){
+            return *reinterpret_cast<T**>(chunk + column.offset)[chunkRow];
+        }
+        return reinterpret_cast<T*>(chunk + column.offset)[chunkRow];
+    }
 
-            if(component2 != nullptr){
-                Component *component1 = entity->components.get(typeId1);
+    template <typename... Ts, typename Func> void ECS::forEach(Func &&routine){
+        forEach<Ts...>(0, routine);
+    }
+
+    template <typename... Ts, typename Func> void ECS::forEach(uint32_t sinceTick, Func &&routine){
+        static_assert(sizeof...(Ts) > 0, "forEach needs at least one component type");
+        forEachInArchetypes<Ts...>(routine, *getQuery<Ts...>(), sinceTick, std::index_sequence_for<Ts...>{});
+    }
 
-                routine(component1Arr->at(component1->componentIndex), component2Arr->at(component2->componentIndex));
+    template <typename T, typename Func> void ECS::forEachRemoved(uint32_t sinceTick, Func &&routine){
+        TypeID typeId = getTypeID<T>();
+        const std::vector<RemovedComponent> &removedComponents = changeManager.removedComponents;
+
+        auto it = std::partition_point(removedComponents.begin(), removedComponents.end(), [sinceTick](const RemovedComponent &removal){
+            return removal.tick <= sinceTick;
+        });
+        for(; it != removedComponents.end(); it++){
+            if(it->typeId == typeId){
+                routine(it->entityID);
             }
         }
     }
 
-    template <typename T1, typename T2> void ECS::forEach(std::function<void(T1 &t1, T2 &t2, EntityID entityID)> routine){
-        TypeID typeId1 = getTypeID<T1>();
-        if(componentTypeExists(typeId1) == false){return;}
-        ComponentType *componentType1 = getComponentType(typeId1);
-        std::vector<T1>* component1Arr = static_cast<std::vector<T1>*>(componentType1->arrayLocation);
+    template <typename... Ts> Query<Ts...> ECS::createQuery(){
+        static_assert(sizeof...(Ts) > 0, "createQuery needs at least one component type");
+        return Query<Ts...>(*this, getQuery<Ts...>());
+    }
+
+    template <typename... Ts> ECS::QueryCache* ECS::getQuery(){
+        QueryFilter filter;
+        auto addTerm = [&filter](QueryTermMatch match, const ComponentSignature &components){
+            switch(match){
+                case QueryTermMatch::Required: filter.requiredComponents |= components; break;
+                case QueryTermMatch::Excluded: filter.excludedComponents |= components; break;
+                case QueryTermMatch::AnyOf: filter.anyOfComponents.push_back(components); break;
+                case QueryTermMatch::Optional: break;
+            }
+        };
+        (addTerm(QueryTerm<Ts>::match, QueryTerm<Ts>::getComponents()), ...);
+
+        return getQuery(filter);
+    }
 
-        TypeID typeId2 = getTypeID<T2>();
-        if(componentTypeExists(typeId2) == false){return;}
-        ComponentType *componentType2 = getComponentType(typeId2);
-        std::vector<T2>* component2Arr = static_cast<std::vector<T2>*>(componentType2->arrayLocation);
+    template <typename T> const ECS::ArchetypeColumn* ECS::getQueryColumn(Archetype &archetype){
+        if constexpr(hasQueryColumn<T>){
+            std::size_t *columnIndex = archetype.columnIndexes.get(getTypeID<typename QueryTerm<T>::Component>());
+            return columnIndex != nullptr ? &archetype.columns[*columnIndex] : nullptr;
+        }else{
+            return nullptr;
+        }
+    }
 
-        for(std::size_t i = 0; i < componentType1->entitiesUsingThis.size(); i++){
+    template <typename... Ts, std::size_t... Is> void ECS::markQueryChunkChanged(Archetype &archetype, const ArchetypeColumn *const *columns, std::size_t row, std::index_sequence<Is...>){
+        // Marked once per chunk before it is iterated since jobs can share a chunk, forEachInChunk marks the rows themselves.
+        // Shared columns are marked when their value is copied on write
+        auto markColumn = [&](const ArchetypeColumn *column){
+            if(column != nullptr && !column->isShared){
+                raiseChunkChangeTick(&archetype, getChunkChangeTickIndex(&archetype, column - archetype.columns.data(), row), changeManager.tick);
+            }
+        };
+        ((!hasQueryColumn<Ts> || std::is_const_v<typename QueryTerm<Ts>::Component> ? void() : markColumn(columns[Is])), ...);
+    }
 
-            EntityID entityID = componentType1->entitiesUsingThis.at(i);
-            Entity *entity = &entityManager.entities.at(entityID);
+    template <typename... Ts, typename Func, std::size_t... Is> void ECS::forEachInArchetypes(Func &routine, const QueryCache &query, uint32_t sinceTick, std::index_sequence<Is...>){
+        // Adding or removing entities and components in the routine isn't supported, it moves rows and can add archetypes which leaves
+        // the archetype and columns read here dangling, the routine records them in a command buffer instead.
+        // Copying a shared value on write only adds a row to the archetype of the values, which exists already and isn't matched
+        for(std::size_t i = 0; i < query.archetypes.size(); i++){
+            Archetype &archetype = archetypeManager.archetypes[query.archetypes[i]];
 
-            Component *component2 = entity->components.get(typeId2);
+            const ArchetypeColumn *columns[] = {getQueryColumn<Ts>(archetype)...};
 
-            if(component2 != nullptr){
-                Component *component1 = entity->components.get(typeId1);
+            for(std::size_t chunkIndex = 0; chunkIndex < archetype.chunks.size(); chunkIndex++){
+                std::size_t firstRow = chunkIndex * archetype.chunkCapacity;
+                std::size_t rowCount = std::min(archetype.chunkCapacity, archetype.size - firstRow);
 
-                routine(component1Arr->at(component1->componentIndex), component2Arr->at(component2->componentIndex), entityID);
+                markQueryChunkChanged<Ts...>(archetype, columns, firstRow, std::index_sequence<Is...>{});
+                forEachInChunk<Ts...>(routine, columns, archetype.chunks[chunkIndex], 0, rowCount, sinceTick, std::index_sequence<Is...>{});
             }
         }
     }
 
-    template <typename T> void ECS::pruneComponentList(){
-        TypeID typeId = getTypeID<T>();
-        ComponentType *componentType = getComponentType(typeId);
-        std::vector<T>* componentArr = static_cast<std::vector<T>*>(componentType->arrayLocation);
+    template <typename... Ts, typename Func> void ECS::parallelForEach(Func &&routine, std::size_t grainSize){
+        parallelForEach<Ts...>(0, routine, grainSize);
+    }
+
+    template <typename... Ts, typename Func> void ECS::parallelForEach(uint32_t sinceTick, Func &&routine, std::size_t grainSize){
+        static_assert(sizeof...(Ts) > 0, "parallelForEach needs at least one component type");
+        parallelForEachInArchetypes<Ts...>(routine, *getQuery<Ts...>(), sinceTick, grainSize, std::index_sequence_for<Ts...>{});
+    }
 
-        if(componentType->tombstoneComponents.empty()){
-            return;
+    template <typename... Ts, typename Func, std::size_t... Is> void ECS::parallelForEachInArchetypes(Func &routine, const QueryCache &query, uint32_t sinceTick, std::size_t grainSize, std::index_sequence<Is...>){
+        grainSize = std::max<std::size_t>(grainSize, 1);
+
+        // Split the matching rows into jobs of grainSize rows, a job can span several chunks
+        std::vector<ChunkRange> ranges;
+        std::vector<std::size_t> jobStarts;
+        std::size_t jobRows = 0;
+
+        for(std::size_t i : query.archetypes){
+            Archetype &archetype = archetypeManager.archetypes[i];
+
+            // Writing a shared component can copy its value, which can't happen from the jobs
+            const ArchetypeColumn *columns[] = {getQueryColumn<Ts>(archetype)...};
+            ((std::is_const_v<typename QueryTerm<Ts>::Component> ? void() : checkParallelWrite(columns[Is])), ...);
+
+            for(std::size_t chunkIndex = 0; chunkIndex < archetype.chunks.size(); chunkIndex++){
+                std::size_t rowCount = std::min(archetype.chunkCapacity, archetype.size - chunkIndex * archetype.chunkCapacity);
+
+                std::size_t begin = 0;
+                while(begin < rowCount){
+                    if(jobRows == 0){
+                        jobStarts.push_back(ranges.size());
+                    }
+                    std::size_t end = std::min(rowCount, begin + grainSize - jobRows);
+                    ranges.push_back({i, chunkIndex, begin, end});
+                    markQueryChunkChanged<Ts...>(archetype, columns, chunkIndex * archetype.chunkCapacity, std::index_sequence<Is...>{});
+
+                    jobRows += end - begin;
+                    if(jobRows == grainSize){
+                        jobRows = 0;
+                    }
+                    begin = end;
+                }
+            }
         }
+        jobStarts.push_back(ranges.size());
+
+        getJobSystem().run(jobStarts.size() - 1, [&](std::size_t jobIndex){
+            for(std::size_t i = jobStarts[jobIndex]; i < jobStarts[jobIndex + 1]; i++){
+                const ChunkRange &range = ranges[i];
+                Archetype &archetype = archetypeManager.archetypes[range.archetype];
 
-        std::size_t i = componentType->tombstoneComponents.size() - 1;
-        std::size_t expected = componentArr->size() - 1;
+                const ArchetypeColumn *columns[] = {getQueryColumn<Ts>(archetype)...};
 
-        while(componentType->tombstoneComponents.at(i) == expected){
-            componentArr->pop_back();
-            componentType->tombstoneComponents.pop_back();
-            expected --;
-            if(i <= 0){
+                forEachInChunk<Ts...>(routine, columns, archetype.chunks[range.chunk], range.begin, range.end, sinceTick, std::index_sequence<Is...>{});
+            }
+        });
+    }
+
+    template <typename... Ts, typename Func, std::size_t... Is> void ECS::forEachInChunk(Func &routine, const ArchetypeColumn *const *columns, uint8_t *chunk, std::size_t begin, std::size_t end, uint32_t sinceTick, std::index_sequence<Is...>){
+        using Arguments = decltype(std::tuple_cat(std::declval<typename QueryTerm<Ts>::Arguments>()...));
+        constexpr bool passEntityID = IsQueryRoutine<Func, Arguments, EntityID>::value;
+        static_assert(passEntityID || IsQueryRoutine<Func, Arguments>::value, "forEach routine must take (Ts&...) or (Ts&..., EntityID), with T* for Optional<T> and nothing for Without<T> and AnyOf<Ts...>");
+
+        EntityID *entityIDs = reinterpret_cast<EntityID*>(chunk);
+
+        // Filtered rows are checked one by one and only the matching rows of non const columns are marked,
+        // queries with optional, excluded or any of terms also pass their rows one by one
+        if constexpr((QueryTerm<Ts>::isFiltered || ...) || !((QueryTerm<Ts>::match == QueryTermMatch::Required) && ...)){
+            auto markRowChanged = [&](const ArchetypeColumn *column, std::size_t row){
+                if(column != nullptr && !column->isShared){
+                    reinterpret_cast<ComponentTicks*>(chunk + column->tickOffset)[row].changed = changeManager.tick;
+                }
+            };
+
+            for(std::size_t row = begin; row < end; row++){
+                bool isMatch = ((!QueryTerm<Ts>::isFiltered || QueryTerm<Ts>::isMatch(getColumnComponentTicks(*columns[Is], chunk, row), sinceTick)) && ...);
+                if(!isMatch){continue;}
+
+                ((!hasQueryColumn<Ts> || std::is_const_v<typename QueryTerm<Ts>::Component> ? void() : markRowChanged(columns[Is], row)), ...);
+                ((std::is_const_v<typename QueryTerm<Ts>::Component> ? void() : prepareSharedWrite(columns[Is], entityIDs[row])), ...);
+
+                if constexpr (passEntityID){
+                    std::apply(routine, std::tuple_cat(getQueryArguments<Ts>(columns[Is], chunk, row)..., std::tuple<EntityID>(entityIDs[row])));
+                }else{
+                    std::apply(routine, std::tuple_cat(getQueryArguments<Ts>(columns[Is], chunk, row)...));
+                }
+            }
+        }else{
+            // Every visited row of a non const column is marked, the routine can change any of them
+            auto markColumnChanged = [&](const ArchetypeColumn *column){
+                if(column->isShared){return;}
+
+                ComponentTicks *ticks = reinterpret_cast<ComponentTicks*>(chunk + column->tickOffset);
+                for(std::size_t row = begin; row < end; row++){
+                    ticks[row].changed = changeManager.tick;
+                }
+            };
+            ((std::is_const_v<typename QueryTerm<Ts>::Component> ? void() : markColumnChanged(columns[Is])), ...);
+
+            if((columns[Is]->isShared || ...) || (columns[Is]->isStable || ...)){
+                for(std::size_t row = begin; row < end; row++){
+                    ((std::is_const_v<typename QueryTerm<Ts>::Component> ? void() : prepareSharedWrite(columns[Is], entityIDs[row])), ...);
+
+                    if constexpr (passEntityID){
+                        routine(getColumnComponent<typename QueryTerm<Ts>::Component>(*columns[Is], chunk, row)..., entityIDs[row]);
+                    }else{
+                        routine(getColumnComponent<typename QueryTerm<Ts>::Component>(*columns[Is], chunk, row)...);
+                    }
+                }
                 return;
             }
-            i --;
+
+            // Plain pointers to each column so the loop can be inlined and vectorized
+            std::tuple<typename QueryTerm<Ts>::Component*...> arrays = {reinterpret_cast<typename QueryTerm<Ts>::Component*>(chunk + columns[Is]->offset)...};
+
+            for(std::size_t row = begin; row < end; row++){
+                if constexpr (passEntityID){
+                    routine(std::get<Is>(arrays)[row]..., entityIDs[row]);
+                }else{
+                    routine(std::get<Is>(arrays)[row]...);
+                }
+            }
         }
     }
 
-    template <typename T> void ECS::clearComponentList(){
-        TypeID typeId = getTypeID<T>();
-        ComponentType *componentType = getComponentType(typeId);
-        componentType->entitiesUsingThis.clear();
-        componentType->tombstoneComponents.clear();
-        std::vector<T>* componentArr = static_cast<std::vector<T>*>(componentType->arrayLocation);
-        componentArr->clear();
+    template <typename T> auto ECS::getQueryArguments(const ArchetypeColumn *column, uint8_t *chunk, std::size_t chunkRow){
+        using Component = typename QueryTerm<T>::Component;
+
+        if constexpr(QueryTerm<T>::match == QueryTermMatch::Required){
+            return std::tuple<Component&>(getColumnComponent<Component>(*column, chunk, chunkRow));
+        }else if constexpr(QueryTerm<T>::match == QueryTermMatch::Optional){
+            return std::tuple<Component*>(column != nullptr ? &getColumnComponent<Component>(*column, chunk, chunkRow) : nullptr);
+        }else{
+            return std::tuple<>();
+        }
     }
 }
\ No newline at end of file
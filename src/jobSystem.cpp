@@ -0,0 +1,155 @@
+#include "jobSystem.hpp"
+
+namespace BasicECS{
+
+    static thread_local JobSystem *s_CurrentJobSystem = nullptr;
+    static thread_local std::size_t s_CurrentQueueIndex = 0;
+
+    JobSystem::JobSystem(std::size_t threadCount) : queuedJobs(0){
+        if(threadCount == 0){
+            std::size_t hardwareThreads = std::thread::hardware_concurrency();
+            threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+        }
+
+        for(std::size_t i = 0; i < threadCount + 1; i++){
+            queues.push_back(std::make_unique<WorkQueue>());
+        }
+        for(std::size_t i = 0; i < threadCount; i++){
+            workers.emplace_back(&JobSystem::workerLoop, this, i);
+        }
+    }
+
+    JobSystem::~JobSystem(){
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            isStopping = true;
+        }
+        sleepCondition.notify_all();
+
+        for(std::thread &worker : workers){
+            worker.join();
+        }
+    }
+
+    JobSystem& JobSystem::getDefault(){
+        static JobSystem s_DefaultJobSystem;
+        return s_DefaultJobSystem;
+    }
+
+    std::size_t JobSystem::getThreadCount(){
+        return workers.size() + 1;
+    }
+
+    void JobSystem::run(std::size_t jobCount, const JobFunc &routine){
+        if(jobCount == 0){
+            return;
+        }
+
+        Batch batch;
+        batch.routine = &routine;
+        batch.remainingJobs = jobCount;
+
+        // Jobs are counted before they are dealt so a thread that takes one can't count below zero
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            queuedJobs += jobCount;
+        }
+
+        // Jobs are dealt round robin so every thread starts with local work
+        for(std::size_t i = 0; i < queues.size(); i++){
+            std::lock_guard<std::mutex> lock(queues[i]->mutex);
+            for(std::size_t jobIndex = i; jobIndex < jobCount; jobIndex += queues.size()){
+                queues[i]->jobs.push_front({&batch, jobIndex});
+            }
+        }
+        sleepCondition.notify_all();
+
+        std::size_t queueIndex = getQueueIndex();
+
+        while(batch.remainingJobs.load(std::memory_order_acquire) > 0){
+            Job job;
+            if(takeJob(queueIndex, job)){
+                executeJob(job);
+            }else{
+                std::this_thread::yield();
+            }
+        }
+
+        if(batch.exception){
+            std::rethrow_exception(batch.exception);
+        }
+    }
+
+    void JobSystem::workerLoop(std::size_t queueIndex){
+        s_CurrentJobSystem = this;
+        s_CurrentQueueIndex = queueIndex;
+
+        while(true){
+            Job job;
+            if(takeJob(queueIndex, job)){
+                executeJob(job);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            sleepCondition.wait(lock, [this](){ return isStopping || queuedJobs.load() > 0; });
+            if(isStopping && queuedJobs.load() == 0){
+                return;
+            }
+        }
+    }
+
+    std::size_t JobSystem::getQueueIndex(){
+        if(s_CurrentJobSystem == this){
+            return s_CurrentQueueIndex;
+        }
+        return queues.size() - 1;
+    }
+
+    bool JobSystem::popJob(std::size_t queueIndex, Job &job){
+        WorkQueue &queue = *queues[queueIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if(queue.jobs.empty()){
+            return false;
+        }
+        job = queue.jobs.back();
+        queue.jobs.pop_back();
+        return true;
+    }
+
+    bool JobSystem::stealJob(std::size_t queueIndex, Job &job){
+        for(std::size_t i = 1; i < queues.size(); i++){
+            WorkQueue &queue = *queues[(queueIndex + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if(!queue.jobs.empty()){
+                job = queue.jobs.front();
+                queue.jobs.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool JobSystem::takeJob(std::size_t queueIndex, Job &job){
+        if(queuedJobs.load(std::memory_order_acquire) == 0){
+            return false;
+        }
+        if(popJob(queueIndex, job) || stealJob(queueIndex, job)){
+            queuedJobs --;
+            return true;
+        }
+        return false;
+    }
+
+    void JobSystem::executeJob(Job &job){
+        try{
+            (*job.batch->routine)(job.jobIndex);
+        }catch(...){
+            std::lock_guard<std::mutex> lock(job.batch->exceptionMutex);
+            if(!job.batch->exception){
+                job.batch->exception = std::current_exception();
+            }
+        }
+        job.batch->remainingJobs.fetch_sub(1, std::memory_order_release);
+    }
+}
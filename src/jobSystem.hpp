@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <exception>
+
+namespace BasicECS{
+
+    using JobFunc = std::function<void(std::size_t jobIndex)>;
+
+    class JobSystem{
+    public:
+        /**
+         * @brief Starts the worker threads
+         * @param threadCount The number of worker threads (0 uses one less than the hardware concurrency)
+         */
+        JobSystem(std::size_t threadCount = 0);
+        /**
+         * @brief Finishes the queued jobs and joins the worker threads
+         */
+        ~JobSystem();
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        /**
+         * @brief Runs a routine once for every job index and waits for them, the calling thread helps while it waits.
+         * If jobs throw, the other jobs still run and the first exception is rethrown on the calling thread
+         * @param jobCount The number of jobs to run 
+         * @param routine The function for each job (function parameters: std::size_t jobIndex)
+         */
+        void run(std::size_t jobCount, const JobFunc &routine);
+
+        /**
+         * @brief Gets the number of threads that run jobs
+         * @return The number of worker threads plus the calling thread
+         */
+        std::size_t getThreadCount();
+
+        /**
+         * @brief Gets the job system shared by every ecs that doesn't set its own
+         * @return A reference to the default job system
+         */
+        static JobSystem& getDefault();
+
+    private:
+        struct Batch {
+            const JobFunc *routine;
+            std::atomic<std::size_t> remainingJobs;
+            // The first exception a job threw, rethrown by run once every job finished
+            std::mutex exceptionMutex;
+            std::exception_ptr exception;
+        };
+        struct Job {
+            Batch *batch;
+            std::size_t jobIndex;
+        };
+        // Owners take jobs from the back of their queue, other threads steal from the front
+        struct WorkQueue {
+            std::mutex mutex;
+            std::deque<Job> jobs;
+        };
+
+    private:
+        void workerLoop(std::size_t queueIndex);
+        std::size_t getQueueIndex();
+        bool popJob(std::size_t queueIndex, Job &job);
+        bool stealJob(std::size_t queueIndex, Job &job);
+        bool takeJob(std::size_t queueIndex, Job &job);
+        void executeJob(Job &job);
+
+    private:
+        std::vector<std::thread> workers;
+        // One queue per worker, the last queue is shared by threads outside the job system
+        std::vector<std::unique_ptr<WorkQueue>> queues;
+
+        std::atomic<std::size_t> queuedJobs;
+        std::mutex sleepMutex;
+        std::condition_variable sleepCondition;
+        bool isStopping = false;
+    };
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "query.hpp"
+
+namespace BasicECS{
+    template <typename... Ts> Query<Ts...>::Query(ECS &ecs, ECS::QueryCache *query) : ecs(&ecs), query(query) {}
+
+    template <typename... Ts> template <typename Func> void Query<Ts...>::forEach(Func &&routine){
+        forEach(0, routine);
+    }
+
+    template <typename... Ts> template <typename Func> void Query<Ts...>::forEach(uint32_t sinceTick, Func &&routine){
+        ecs->template forEachInArchetypes<Ts...>(routine, *query, sinceTick, std::index_sequence_for<Ts...>{});
+    }
+
+    template <typename... Ts> template <typename Func> void Query<Ts...>::parallelForEach(Func &&routine, std::size_t grainSize){
+        parallelForEach(0, routine, grainSize);
+    }
+
+    template <typename... Ts> template <typename Func> void Query<Ts...>::parallelForEach(uint32_t sinceTick, Func &&routine, std::size_t grainSize){
+        ecs->template parallelForEachInArchetypes<Ts...>(routine, *query, sinceTick, grainSize, std::index_sequence_for<Ts...>{});
+    }
+
+    template <typename... Ts> std::size_t Query<Ts...>::count(){
+        return ecs->countQueryEntities(*query);
+    }
+}
@@ -0,0 +1,97 @@
+#include "scheduler.hpp"
+
+#include <algorithm>
+
+namespace BasicECS{
+
+    Scheduler::Scheduler(ECS &ecs) : ecs(ecs){}
+
+    SystemID Scheduler::addExclusiveSystem(std::string name, SystemFunc routine){
+        return addExclusiveSystem(name, [routine](ECS &ecs, uint32_t lastRunTick){ routine(ecs); });
+    }
+
+    SystemID Scheduler::addExclusiveSystem(std::string name, ChangeSystemFunc routine){
+        return addSystem({
+            .name = name,
+            .routine = routine,
+            .reads = {},
+            .writes = {},
+            .isExclusive = true
+        });
+    }
+
+    SystemID Scheduler::addSystem(System system){
+        systems.push_back(system);
+        isBatchesDirty = true;
+        return systems.size() - 1;
+    }
+
+    bool Scheduler::conflicts(const System &system1, const System &system2){
+        if(system1.isExclusive || system2.isExclusive){
+            return true;
+        }
+        return (system1.writes & (system2.reads | system2.writes)).any() || (system2.writes & system1.reads).any();
+    }
+
+    void Scheduler::buildBatches(){
+        // A system runs one batch after the latest earlier system it conflicts with,
+        // so the batches are the levels of the dependency graph
+        std::vector<std::size_t> systemBatches(systems.size(), 0);
+        batches.clear();
+
+        for(std::size_t i = 0; i < systems.size(); i++){
+            for(std::size_t j = 0; j < i; j++){
+                if(conflicts(systems.at(j), systems.at(i))){
+                    systemBatches.at(i) = std::max(systemBatches.at(i), systemBatches.at(j) + 1);
+                }
+            }
+
+            if(systemBatches.at(i) >= batches.size()){
+                batches.resize(systemBatches.at(i) + 1);
+            }
+            batches.at(systemBatches.at(i)).push_back(i);
+        }
+
+        isBatchesDirty = false;
+    }
+
+    std::vector<std::vector<SystemID>> Scheduler::getSystemBatches(){
+        if(isBatchesDirty){
+            buildBatches();
+        }
+        return batches;
+    }
+
+    void Scheduler::runSystems(){
+        if(isBatchesDirty){
+            buildBatches();
+        }
+
+        for(const std::vector<SystemID> &batch : batches){
+            uint32_t tick = ecs.getChangeTick();
+
+            // Copying a shared value on write is a structural change, only exclusive systems can do it
+            ecs.sharedComponentManager.isWriteBlocked = !systems.at(batch.at(0)).isExclusive;
+            try{
+                if(batch.size() == 1){
+                    systems.at(batch.at(0)).routine(ecs, systems.at(batch.at(0)).lastRunTick);
+                }else{
+                    ecs.getJobSystem().run(batch.size(), [this, &batch](std::size_t jobIndex){
+                        System &system = systems.at(batch.at(jobIndex));
+                        system.routine(ecs, system.lastRunTick);
+                    });
+                }
+            }catch(...){
+                ecs.sharedComponentManager.isWriteBlocked = false;
+                throw;
+            }
+            ecs.sharedComponentManager.isWriteBlocked = false;
+
+            // The changes a system makes are stamped with the tick it ran at, so it doesn't see them next time
+            for(SystemID systemID : batch){
+                systems.at(systemID).lastRunTick = tick;
+            }
+            ecs.advanceChangeTick();
+        }
+    }
+}
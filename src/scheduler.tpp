@@ -0,0 +1,31 @@
+#pragma once
+
+#include "scheduler.hpp"
+
+namespace BasicECS{
+    template <typename... Ts> ComponentSignature Scheduler::getSignature(Reads<Ts...>){
+        ComponentSignature signature;
+        (signature.set(ECS::getTypeID<Ts>()), ...);
+        return signature;
+    }
+
+    template <typename... Ts> ComponentSignature Scheduler::getSignature(Writes<Ts...>){
+        ComponentSignature signature;
+        (signature.set(ECS::getTypeID<Ts>()), ...);
+        return signature;
+    }
+
+    template <typename ReadList, typename WriteList> SystemID Scheduler::addSystem(std::string name, SystemFunc routine){
+        return addSystem<ReadList, WriteList>(name, [routine](ECS &ecs, uint32_t lastRunTick){ routine(ecs); });
+    }
+
+    template <typename ReadList, typename WriteList> SystemID Scheduler::addSystem(std::string name, ChangeSystemFunc routine){
+        return addSystem({
+            .name = name,
+            .routine = routine,
+            .reads = getSignature(ReadList{}),
+            .writes = getSignature(WriteList{}),
+            .isExclusive = false
+        });
+    }
+}
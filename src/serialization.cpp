@@ -0,0 +1,54 @@
+#include "serialization.hpp"
+
+#include <iostream>
+
+namespace BasicECS{
+
+    Writer::Writer(std::vector<uint8_t> &buffer) : buffer(buffer), start(buffer.size()){}
+
+    void Writer::write(const void *data, std::size_t size){
+        const uint8_t *bytes = static_cast<const uint8_t*>(data);
+        buffer.insert(buffer.end(), bytes, bytes + size);
+    }
+
+    void Writer::write(const std::string &string){
+        write<uint64_t>(string.size());
+        write(string.data(), string.size());
+    }
+
+    std::size_t Writer::getSize(){
+        return buffer.size() - start;
+    }
+
+    Reader::Reader(const uint8_t *data, std::size_t size) : data(data), size(size){}
+
+    Reader::Reader(const std::vector<uint8_t> &buffer) : data(buffer.data()), size(buffer.size()){}
+
+    const uint8_t* Reader::read(std::size_t size){
+        if(size > this->size - position){
+            std::cerr << "ERROR: can't read " << size << " bytes, only " << this->size - position << " bytes are left\n";
+            throw std::exception();
+        }
+
+        const uint8_t *bytes = data + position;
+        position += size;
+        return bytes;
+    }
+
+    void Reader::read(void *destination, std::size_t size){
+        if(size == 0){
+            return;
+        }
+        std::memcpy(destination, read(size), size);
+    }
+
+    std::string Reader::readString(){
+        std::size_t length = read<uint64_t>();
+        const char *characters = reinterpret_cast<const char*>(read(length));
+        return std::string(characters, length);
+    }
+
+    std::size_t Reader::getRemaining(){
+        return size - position;
+    }
+}
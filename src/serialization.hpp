@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace BasicECS{
+
+    class Writer{
+    public:
+        /**
+         * @brief Creates a writer that appends to a buffer, the buffer can be reused for many writers
+         * @param buffer The buffer to append to (it isn't cleared)
+         */
+        Writer(std::vector<uint8_t> &buffer);
+
+        /**
+         * @brief Appends bytes to the buffer
+         * @param data The bytes to append
+         * @param size The number of bytes
+         */
+        void write(const void *data, std::size_t size);
+        /**
+         * @brief Appends the bytes of a trivially copyable value to the buffer
+         * @tparam T The type of the value
+         * @param value The value to append
+         */
+        template <typename T> void write(const T &value);
+        /**
+         * @brief Appends the length and the characters of a string to the buffer
+         * @param string The string to append
+         */
+        void write(const std::string &string);
+
+        /**
+         * @brief Gets the number of bytes appended by this writer
+         * @return The number of bytes
+         */
+        std::size_t getSize();
+
+    private:
+        std::vector<uint8_t> &buffer;
+        std::size_t start;
+    };
+
+    class Reader{
+    public:
+        /**
+         * @brief Creates a reader over bytes, the bytes aren't copied and must outlive the reader
+         * @param data The bytes to read
+         * @param size The number of bytes
+         */
+        Reader(const uint8_t *data, std::size_t size);
+        /**
+         * @brief Creates a reader over a buffer, the buffer isn't copied and must outlive the reader
+         * @param buffer The buffer to read
+         */
+        Reader(const std::vector<uint8_t> &buffer);
+
+        /**
+         * @brief Reads bytes without copying them
+         * @param size The number of bytes to read
+         * @return A pointer to the bytes, valid as long as the bytes of the reader
+         */
+        const uint8_t* read(std::size_t size);
+        /**
+         * @brief Copies bytes out of the reader
+         * @param destination Where to copy the bytes to
+         * @param size The number of bytes to read
+         */
+        void read(void *destination, std::size_t size);
+        /**
+         * @brief Reads a trivially copyable value
+         * @tparam T The type of the value
+         * @return The value
+         */
+        template <typename T> T read();
+        /**
+         * @brief Reads a string written with Writer::write(const std::string&)
+         * @return The string
+         */
+        std::string readString();
+
+        /**
+         * @brief Gets the number of bytes left to read
+         * @return The number of bytes
+         */
+        std::size_t getRemaining();
+
+    private:
+        const uint8_t *data;
+        std::size_t size;
+        std::size_t position = 0;
+    };
+}
+
+#include "serialization.tpp"
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "serialization.hpp"
+
+#include <cstring>
+#include <type_traits>
+
+namespace BasicECS{
+    template <typename T> void Writer::write(const T &value){
+        static_assert(std::is_trivially_copyable<T>(), "Writer::write needs a trivially copyable type");
+        write(&value, sizeof(T));
+    }
+
+    template <typename T> T Reader::read(){
+        static_assert(std::is_trivially_copyable<T>(), "Reader::read needs a trivially copyable type");
+        T value;
+        std::memcpy(&value, read(sizeof(T)), sizeof(T));
+        return value;
+    }
+}
@@ -1,6 +1,11 @@
 #include <iostream>
 #include <ecs.hpp>
+#include <scheduler.hpp>
 #include <sstream>
+#include <chrono>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
 
 #include "test.hpp"
 
@@ -18,39 +23,64 @@ int main() {
     LOG_TEST_RESULT(parentingTest);
     LOG_TEST_RESULT(clearingTest);
     LOG_TEST_RESULT(removingEntityTest);
+    LOG_TEST_RESULT(archetypeTest);
+    LOG_TEST_RESULT(variadicForEachTest);
+    LOG_TEST_RESULT(componentChurnTest);
+    LOG_TEST_RESULT(componentMapTest);
+    LOG_TEST_RESULT(hasComponentTest);
+    LOG_TEST_RESULT(denseTypeIDTest);
+    LOG_TEST_RESULT(parallelForEachTest);
+    LOG_TEST_RESULT(schedulerTest);
+    LOG_TEST_RESULT(commandBufferTest);
+    LOG_TEST_RESULT(bulkCreationTest);
+    LOG_TEST_RESULT(entityGenerationTest);
+    LOG_TEST_RESULT(referenceCachingTest);
+    LOG_TEST_RESULT(snapshotTest);
+    LOG_TEST_RESULT(mappedSnapshotTest);
+    LOG_TEST_RESULT(streamingSerializationTest);
+    LOG_TEST_RESULT(deltaSnapshotTest);
+    LOG_TEST_RESULT(changeFilterTest);
+    LOG_TEST_RESULT(allocatorTest);
+    LOG_TEST_RESULT(stableComponentTest);
+    LOG_TEST_RESULT(hierarchyTest);
+    LOG_TEST_RESULT(subtreeRemovalTest);
+    LOG_TEST_RESULT(propagateHierarchyTest);
+    LOG_TEST_RESULT(sharedValueTest);
+    LOG_TEST_RESULT(cachedQueryTest);
+    LOG_TEST_RESULT(queryTermsTest);
 
     basicEcsSpeedTest(1000000);
+    basicEcsRemovalSpeedTest(500000);
+    basicEcsRemovalSpeedTest(1000000);
+    basicEcsSpawnSpeedTest(500000);
 
     return 0;
 }
 
 struct Position { float x, y, z; };
 struct Velocity { float dx, dy, dz; };
+struct Health { int value; };
+struct Name { std::string value; };
 
 void initialiseVelocity(BasicECS::ECS &ecs, BasicECS::EntityID entity) { ecs.getComponent<Position>(entity).x = 10;}
 void deinitializeVelocity(BasicECS::ECS &ecs, BasicECS::EntityID entity) { ecs.getComponent<Position>(entity).x = -5;}
 
-std::vector<uint8_t> serializePosition(BasicECS::ECS &ecs, BasicECS::EntityID entity){
-    std::vector<uint8_t> serializedData;
-
+void serializePosition(BasicECS::ECS &ecs, BasicECS::EntityID entity, BasicECS::Writer &writer){
     Position component = ecs.getComponent<Position>(entity);
     component.x *= 2;
-    uint8_t* componentData = reinterpret_cast<uint8_t*>(&component);
-    serializedData.insert(serializedData.end(), componentData, componentData + sizeof(Position));
-
-    return serializedData;
+    writer.write(component);
 }
 
-void deserializePosition(BasicECS::ECS &ecs, BasicECS::EntityID entity, std::vector<uint8_t> data){
-    Position component;
-
-    if (data.size() != sizeof(Position)) {
-        throw std::runtime_error("Invalid data size for component deserialization.");
-    }
+void deserializePosition(BasicECS::ECS &ecs, BasicECS::EntityID entity, BasicECS::Reader &reader){
+    ecs.addComponent(entity, reader.read<Position>());
+}
 
-    std::memcpy(&component, data.data(), sizeof(Position));
+void serializeName(BasicECS::ECS &ecs, BasicECS::EntityID entity, BasicECS::Writer &writer){
+    writer.write(ecs.getComponent<const Name>(entity).value);
+}
 
-    ecs.addComponent(entity, component);
+void deserializeName(BasicECS::ECS &ecs, BasicECS::EntityID entity, BasicECS::Reader &reader){
+    ecs.addComponent(entity, Name{reader.readString()});
 }
 
 bool createEntitiesTest(){
@@ -170,7 +200,7 @@ bool initializeComponentTest(){
 
     ecs.removeComponent<Velocity>(entity1);
 
-    TEST_ASSERT(pos.x == -5);
+    TEST_ASSERT(ecs.getComponent<Position>(entity1).x == -5);
 
     return true;
 }
@@ -467,6 +497,1534 @@ bool removingEntityTest(){
     return true;
 }
 
+bool archetypeTest(){
+    BasicECS::ECS ecs;
+
+    std::vector<BasicECS::EntityID> entities;
+
+    for(int i = 0; i < 3000; i++){
+        BasicECS::EntityID entity;
+        ecs.addEntity(entity)
+            .addComponent(Position{(float)i, 0, 0});
+
+        if(i % 2 == 0){
+            ecs.addComponent(entity, Velocity{1, 0, 0});
+        }
+        if(i % 3 == 0){
+            ecs.addComponent(entity, Health{i});
+        }
+        entities.push_back(entity);
+    }
+
+    int iterations = 0;
+
+    ecs.forEach<Position, Velocity>([&iterations](Position &pos, Velocity &vel){
+        pos.x += vel.dx;
+        iterations ++;
+    });
+
+    TEST_ASSERT(iterations == 1500);
+
+    for(int i = 0; i < 3000; i += 4){
+        ecs.removeComponent<Velocity>(entities.at(i));
+    }
+
+    iterations = 0;
+
+    ecs.forEach<Velocity, Health>([&iterations](Velocity &vel, Health &health, BasicECS::EntityID entityID){
+        iterations ++;
+    });
+
+    TEST_ASSERT(iterations == 250);
+
+    for(int i = 0; i < 3000; i++){
+        Position &pos = ecs.getComponent<Position>(entities.at(i));
+        float expected = (i % 2 == 0) ? i + 1 : i;
+        TEST_ASSERT(pos.x == expected);
+    }
+
+    for(int i = 0; i < 3000; i += 3){
+        TEST_ASSERT(ecs.getComponent<Health>(entities.at(i)).value == i);
+    }
+
+    return true;
+}
+
+struct ApplyVelocity {
+    float deltaTime;
+
+    void operator()(Position &pos, const Velocity &vel, Health &health){
+        pos.x += vel.dx * deltaTime;
+        health.value --;
+    }
+};
+
+bool variadicForEachTest(){
+    BasicECS::ECS ecs;
+
+    BasicECS::EntityID entity1;
+    ecs.addEntity(entity1)
+        .addComponent(Position{0,0,0})
+        .addComponent(Velocity{2,0,0})
+        .addComponent(Health{10});
+
+    BasicECS::EntityID entity2;
+    ecs.addEntity(entity2)
+        .addComponent(Position{0,0,0})
+        .addComponent(Velocity{4,0,0});
+
+    BasicECS::EntityID entity3;
+    ecs.addEntity(entity3)
+        .addComponent(Health{5})
+        .addComponent(Velocity{1,0,0})
+        .addComponent(Position{1,0,0});
+
+    ecs.forEach<Position, Velocity, Health>(ApplyVelocity{0.5f});
+
+    TEST_ASSERT(ecs.getComponent<Position>(entity1).x == 1);
+    TEST_ASSERT(ecs.getComponent<Position>(entity2).x == 0);
+    TEST_ASSERT(ecs.getComponent<Position>(entity3).x == 1.5);
+    TEST_ASSERT(ecs.getComponent<Health>(entity3).value == 4);
+
+    std::vector<BasicECS::EntityID> visited;
+
+    ecs.forEach<Health, Position, Velocity>([&visited](Health &health, Position &pos, Velocity &vel, BasicECS::EntityID entityID){
+        visited.push_back(entityID);
+    });
+
+    TEST_ASSERT(visited.size() == 2);
+    TEST_ASSERT(std::find(visited.begin(), visited.end(), entity2) == visited.end());
+
+    int iterations = 0;
+
+    ecs.forEach<Velocity>([&iterations](auto &vel){
+        iterations ++;
+    });
+
+    TEST_ASSERT(iterations == 3);
+
+    return true;
+}
+
+bool componentChurnTest(){
+    BasicECS::ECS ecs;
+
+    std::vector<BasicECS::EntityID> entities;
+
+    for(int i = 0; i < 10000; i++){
+        BasicECS::EntityID entity;
+        ecs.addEntity(entity)
+            .addComponent(Position{(float)i, 0, 0})
+            .addComponent(Health{i});
+        entities.push_back(entity);
+    }
+
+    for(int round = 0; round < 3; round++){
+        for(int i = round; i < 10000; i += 3){
+            ecs.removeComponent<Health>(entities.at(i));
+        }
+        for(int i = round; i < 10000; i += 3){
+            ecs.addComponent(entities.at(i), Health{i});
+        }
+    }
+
+    for(int i = 0; i < 10000; i += 5){
+        ecs.removeEntity(entities.at(i));
+    }
+
+    int iterations = 0;
+    bool matching = true;
+
+    ecs.forEach<Position, Health>([&iterations, &matching](Position &pos, Health &health){
+        matching = matching && pos.x == health.value;
+        iterations ++;
+    });
+
+    TEST_ASSERT(matching);
+    TEST_ASSERT(iterations == 8000);
+
+    for(int i = 1; i < 10000; i += 5){
+        TEST_ASSERT(ecs.getComponent<Health>(entities.at(i)).value == i);
+    }
+
+    return true;
+}
+
+bool componentMapTest(){
+    ComponentMap<std::size_t> map;
+
+    for(std::size_t i = 0; i < 100; i++){
+        map.insert(i * 7, i);
+    }
+
+    TEST_ASSERT(map.size() == 100);
+
+    for(std::size_t i = 0; i < 100; i += 2){
+        map.erase(i * 7);
+    }
+
+    TEST_ASSERT(map.size() == 50);
+
+    for(std::size_t i = 0; i < 100; i++){
+        std::size_t *value = map.get(i * 7);
+        if(i % 2 == 0){
+            TEST_ASSERT(value == nullptr);
+        }else{
+            TEST_ASSERT(value != nullptr && *value == i);
+        }
+    }
+
+    map.insert(21, 42);
+    TEST_ASSERT(*map.get(21) == 42);
+    TEST_ASSERT(map.size() == 50);
+
+    return true;
+}
+
+bool hasComponentTest(){
+    BasicECS::ECS ecs;
+
+    BasicECS::EntityID entity1;
+    ecs.addEntity(entity1)
+        .addComponent(Velocity{2,2,3});
+
+    BasicECS::EntityID entity2;
+    ecs.addEntity(entity2)
+        .addComponent(Position{1,3,2});
+
+    ecs.addComponent<Velocity>(entity2, entity1);
+
+    TEST_ASSERT(ecs.hasComponent<Velocity>(entity1));
+    TEST_ASSERT(!ecs.hasComponent<Position>(entity1));
+    TEST_ASSERT(!ecs.hasComponent<Health>(entity1));
+    TEST_ASSERT(ecs.hasComponent<Velocity>(entity2));
+    TEST_ASSERT(ecs.hasComponent<Position>(entity2));
+
+    ecs.removeComponent<Velocity>(entity2);
+
+    TEST_ASSERT(!ecs.hasComponent<Velocity>(entity2));
+    TEST_ASSERT(ecs.hasComponent<Velocity>(entity1));
+
+    return true;
+}
+
+bool denseTypeIDTest(){
+    BasicECS::TypeID positionID = BasicECS::ECS::getTypeID<Position>();
+    BasicECS::TypeID velocityID = BasicECS::ECS::getTypeID<Velocity>();
+    BasicECS::TypeID healthID = BasicECS::ECS::getTypeID<Health>();
+
+    TEST_ASSERT(positionID != velocityID && velocityID != healthID && positionID != healthID);
+    TEST_ASSERT(positionID < BasicECS::MaxComponentTypes);
+    TEST_ASSERT(velocityID < BasicECS::MaxComponentTypes);
+    TEST_ASSERT(healthID < BasicECS::MaxComponentTypes);
+    TEST_ASSERT(BasicECS::ECS::getTypeID<Position>() == positionID);
+
+    BasicECS::ECS ecs1;
+    BasicECS::ECS ecs2;
+
+    ecs1.addComponentType<Health>({});
+    ecs2.addComponentType<Health>({});
+
+    TEST_ASSERT(ecs1.getTypeID("Health") == healthID);
+    TEST_ASSERT(ecs2.getTypeID("Health") == healthID);
+
+    return true;
+}
+
+bool parallelForEachTest(){
+    BasicECS::JobSystem jobSystem(4);
+    BasicECS::ECS ecs;
+    ecs.setJobSystem(jobSystem);
+
+    TEST_ASSERT(ecs.getJobSystem().getThreadCount() == 5);
+
+    for(int i = 0; i < 20000; i++){
+        BasicECS::EntityID entity;
+        ecs.addEntity(entity)
+            .addComponent(Position{(float)i, 0, 0})
+            .addComponent(Velocity{1, 2, 0});
+
+        if(i % 4 == 0){
+            ecs.addComponent(entity, Health{i});
+        }
+    }
+
+    std::atomic<int> iterations(0);
+
+    ecs.parallelForEach<Position, Velocity>([&iterations](Position &pos, Velocity &vel){
+        pos.x += vel.dx;
+        pos.y += vel.dy;
+        iterations ++;
+    }, 1000);
+
+    TEST_ASSERT(iterations == 20000);
+
+    bool matching = true;
+
+    ecs.forEach<Position, Health>([&matching](Position &pos, Health &health){
+        matching = matching && pos.x == health.value + 1 && pos.y == 2;
+    });
+
+    TEST_ASSERT(matching);
+
+    std::atomic<int> healthSum(0);
+
+    ecs.parallelForEach<Health>([&healthSum](Health &health, BasicECS::EntityID entityID){
+        healthSum += health.value;
+    }, 7);
+
+    int expectedSum = 0;
+    for(int i = 0; i < 20000; i += 4){
+        expectedSum += i;
+    }
+
+    TEST_ASSERT(healthSum == expectedSum);
+
+    // Nested runs count their jobs before other threads can take them
+    std::atomic<int> nestedJobs(0);
+    jobSystem.run(8, [&](std::size_t jobIndex){
+        jobSystem.run(16, [&](std::size_t nestedIndex){ nestedJobs++; });
+    });
+    TEST_ASSERT(nestedJobs == 8 * 16);
+
+    // The first exception a job throws is rethrown after every job ran
+    std::atomic<int> finishedJobs(0);
+    bool caught = false;
+    try{
+        jobSystem.run(32, [&](std::size_t jobIndex){
+            if(jobIndex == 3){throw std::runtime_error("job failed");}
+            finishedJobs++;
+        });
+    }catch(const std::runtime_error &error){
+        caught = true;
+    }
+    TEST_ASSERT(caught && finishedJobs == 31);
+
+    return true;
+}
+
+bool schedulerTest(){
+    BasicECS::JobSystem jobSystem(4);
+    BasicECS::ECS ecs;
+    ecs.setJobSystem(jobSystem);
+
+    for(int i = 0; i < 1000; i++){
+        ecs.addEntity()
+            .addComponent(Position{0, 0, 0})
+            .addComponent(Velocity{1, 0, 0})
+            .addComponent(Health{0});
+    }
+
+    BasicECS::Scheduler scheduler(ecs);
+    std::atomic<int> movedCount(0);
+    std::atomic<int> healthCount(0);
+
+    BasicECS::SystemID movement = scheduler.addSystem<BasicECS::Reads<Velocity>, BasicECS::Writes<Position>>("movement", [](BasicECS::ECS &ecs){
+        ecs.forEach<Position, const Velocity>([](Position &pos, const Velocity &vel){ pos.x += vel.dx; });
+    });
+    BasicECS::SystemID healing = scheduler.addSystem<BasicECS::Reads<>, BasicECS::Writes<Health>>("healing", [](BasicECS::ECS &ecs){
+        ecs.forEach<Health>([](Health &health){ health.value++; });
+    });
+    BasicECS::SystemID counting = scheduler.addSystem<BasicECS::Reads<Position>>("counting", [&movedCount](BasicECS::ECS &ecs){
+        ecs.forEach<const Position>([&movedCount](const Position &pos){ movedCount += pos.x > 0; });
+    });
+    BasicECS::SystemID auditing = scheduler.addExclusiveSystem("auditing", [&healthCount](BasicECS::ECS &ecs){
+        healthCount = 0;
+        ecs.forEach<Health>([&healthCount](Health &health){ healthCount++; });
+    });
+
+    std::vector<std::vector<BasicECS::SystemID>> batches = scheduler.getSystemBatches();
+
+    TEST_ASSERT(batches.size() == 3);
+    TEST_ASSERT(batches.at(0) == std::vector<BasicECS::SystemID>({movement, healing}));
+    TEST_ASSERT(batches.at(1) == std::vector<BasicECS::SystemID>({counting}));
+    TEST_ASSERT(batches.at(2) == std::vector<BasicECS::SystemID>({auditing}));
+
+    for(int i = 0; i < 3; i++){
+        scheduler.runSystems();
+    }
+
+    TEST_ASSERT(movedCount == 3000);
+    TEST_ASSERT(healthCount == 1000);
+
+    bool matching = true;
+
+    ecs.forEach<Position, Health>([&matching](Position &pos, Health &health){
+        matching = matching && pos.x == 3 && health.value == 3;
+    });
+
+    TEST_ASSERT(matching);
+
+    return true;
+}
+
+bool commandBufferTest(){
+    BasicECS::JobSystem jobSystem(4);
+    BasicECS::ECS ecs;
+    ecs.setJobSystem(jobSystem);
+
+    for(int i = 0; i < 10000; i++){
+        ecs.addEntity()
+            .addComponent(Position{(float)i, 0, 0})
+            .addComponent(Health{i});
+    }
+
+    ecs.parallelForEach<Health>([&ecs](Health &health, BasicECS::EntityID entityID){
+        BasicECS::CommandBuffer &commandBuffer = ecs.getCommandBuffer();
+
+        if(health.value % 2 == 0){
+            commandBuffer.removeComponent<Health>(entityID);
+            commandBuffer.addComponent(entityID, Velocity{1, 0, 0});
+        }
+        if(health.value % 5 == 0){
+            commandBuffer.removeEntity(entityID);
+        }
+        if(health.value % 10 == 1){
+            commandBuffer.addEntity()
+                .addComponent(Position{-1, 0, 0})
+                .addComponent(Velocity{2, 0, 0});
+        }
+    }, 500);
+
+    TEST_ASSERT(ecs.hasComponent<Velocity>(0) == false);
+
+    ecs.flushCommands();
+
+    int healthCount = 0;
+    ecs.forEach<Health>([&healthCount](Health &health){
+        healthCount++;
+    });
+
+    int movingCount = 0;
+    int spawnedCount = 0;
+    bool matching = true;
+    ecs.forEach<Position, Velocity>([&](Position &pos, Velocity &vel){
+        if(pos.x == -1){
+            spawnedCount++;
+            matching = matching && vel.dx == 2;
+        }else{
+            movingCount++;
+            matching = matching && (int)pos.x % 2 == 0 && (int)pos.x % 5 != 0;
+        }
+    });
+
+    TEST_ASSERT(healthCount == 4000);
+    TEST_ASSERT(movingCount == 4000);
+    TEST_ASSERT(spawnedCount == 1000);
+    TEST_ASSERT(matching);
+    TEST_ASSERT(ecs.getCommandBuffer().isEmpty());
+
+    // A command that throws must not leave the buffers locked
+    BasicECS::ECS throwingECS;
+    throwingECS.addComponentType<Velocity>({.initialiseFunc = [](BasicECS::ECS &ecs, BasicECS::EntityID entity){
+        throw std::exception();
+    }});
+    throwingECS.getCommandBuffer().addEntity().addComponent(Velocity{1, 0, 0});
+
+    bool thrown = false;
+    try{
+        throwingECS.flushCommands();
+    }catch(const std::exception &exception){
+        thrown = true;
+    }
+    TEST_ASSERT(thrown);
+    TEST_ASSERT(throwingECS.getCommandBuffer().isEmpty());
+
+    return true;
+}
+
+bool bulkCreationTest(){
+    BasicECS::ECS ecs;
+    ecs.addComponentType<Velocity>({.initialiseFunc = initialiseVelocity});
+
+    ecs.addEntity();
+    ecs.removeEntity(0);
+
+    std::vector<BasicECS::EntityID> entities = ecs.createEntities(5000, Position{1, 2, 3});
+
+    TEST_ASSERT(entities.size() == 5000);
+    TEST_ASSERT(ecs.isEntityValid(0) == false);
+
+    bool matching = true;
+    for(BasicECS::EntityID entity : entities){
+        Position &pos = ecs.getComponent<Position>(entity);
+        matching = matching && pos.x == 1 && pos.y == 2 && pos.z == 3;
+    }
+    TEST_ASSERT(matching);
+
+    std::vector<Velocity> velocities;
+    for(std::size_t i = 0; i < entities.size(); i++){
+        velocities.push_back({(float)i, 0, 0});
+    }
+
+    ecs.addComponents(entities, velocities);
+
+    for(std::size_t i = 0; i < entities.size(); i++){
+        matching = matching && ecs.getComponent<Velocity>(entities.at(i)).dx == i;
+        matching = matching && ecs.getComponent<Position>(entities.at(i)).x == 10;
+    }
+    TEST_ASSERT(matching);
+
+    std::vector<BasicECS::EntityID> movingEntities = ecs.createEntities(100, Position{0, 0, 0}, Velocity{1, 0, 0});
+
+    int count = 0;
+    ecs.forEach<Position, Velocity>([&count](Position &pos, Velocity &vel){
+        count++;
+    });
+
+    TEST_ASSERT(count == 5100);
+    TEST_ASSERT(ecs.getComponent<Position>(movingEntities.back()).x == 10);
+
+    return true;
+}
+
+bool entityGenerationTest(){
+    BasicECS::ECS ecs;
+
+    BasicECS::EntityID entity1;
+    ecs.addEntity(entity1).addComponent(Position{1, 0, 0});
+    BasicECS::EntityGUID entity1GUID = ecs.getEntityGUID(entity1);
+
+    TEST_ASSERT(ecs.isEntityValid(entity1));
+
+    ecs.removeEntity(entity1);
+
+    TEST_ASSERT(ecs.isEntityValid(entity1) == false);
+
+    BasicECS::EntityID entity2;
+    ecs.addEntity(entity2).addComponent(Position{2, 0, 0});
+
+    TEST_ASSERT((entity1 & BasicECS::EntityIndexMask) == (entity2 & BasicECS::EntityIndexMask));
+    TEST_ASSERT(entity1 != entity2);
+    TEST_ASSERT(ecs.isEntityValid(entity1) == false);
+    TEST_ASSERT(ecs.isEntityValid(entity2));
+    TEST_ASSERT(ecs.getComponent<Position>(entity2).x == 2);
+    TEST_ASSERT(ecs.isEntityValid(BasicECS::RootEntityID) == false);
+
+    bool threw = false;
+    try{
+        ecs.getComponent<Position>(entity1);
+    }catch(const std::exception &e){
+        threw = true;
+    }
+    TEST_ASSERT(threw);
+
+    threw = false;
+    try{
+        ecs.getEntityID(entity1GUID);
+    }catch(const std::exception &e){
+        threw = true;
+    }
+    TEST_ASSERT(threw);
+
+    std::vector<BasicECS::EntityID> entities;
+    ecs.forEachEntity([&entities](BasicECS::EntityID entityID){
+        entities.push_back(entityID);
+    });
+    TEST_ASSERT(entities == std::vector<BasicECS::EntityID>({entity2}));
+
+    return true;
+}
+
+bool referenceCachingTest(){
+    BasicECS::ECS ecs;
+
+    std::vector<BasicECS::EntityID> entities = ecs.createEntities(100, Position{0, 0, 0});
+    for(std::size_t i = 0; i < entities.size(); i++){
+        ecs.getComponent<Position>(entities.at(i)).x = i;
+    }
+
+    BasicECS::Reference<Position> reference = ecs.createReference<Position>(entities.at(99));
+
+    TEST_ASSERT(ecs.getComponent(reference).x == 99);
+    TEST_ASSERT(reference.component == &ecs.getComponent<Position>(entities.at(99)));
+
+    ecs.getComponent(reference).y = 5;
+    TEST_ASSERT(ecs.getComponent<Position>(entities.at(99)).y == 5);
+
+    // Removing another entity moves the last row into its place
+    ecs.removeEntity(entities.at(0));
+    TEST_ASSERT(ecs.getComponent(reference).x == 99);
+    TEST_ASSERT(reference.component == &ecs.getComponent<Position>(entities.at(99)));
+
+    ecs.addComponent(entities.at(99), Velocity{1, 0, 0});
+    TEST_ASSERT(ecs.getComponent(reference).x == 99 && ecs.getComponent(reference).y == 5);
+
+    BasicECS::EntityID sharingEntity;
+    ecs.addEntity(sharingEntity).addComponent<Position>(entities.at(50));
+    BasicECS::Reference<Position> sharedReference = ecs.createReference<Position>(sharingEntity);
+
+    TEST_ASSERT(ecs.getComponent(sharedReference).x == 50);
+
+    ecs.removeEntity(entities.at(99));
+
+    bool threw = false;
+    try{
+        ecs.getComponent(reference);
+    }catch(const std::exception &e){
+        threw = true;
+    }
+    TEST_ASSERT(threw);
+
+    return true;
+}
+
+bool snapshotTest(){
+    std::stringstream snapshot;
+    BasicECS::EntityID parent, child, sharingEntity, removedEntity;
+    BasicECS::EntityGUID childGUID;
+
+    {
+        BasicECS::ECS ecs;
+        ecs.addComponentType<Name>({.serializeFunc = serializeName, .deserializeFunc = deserializeName});
+
+        ecs.createEntities(1000, Position{1, 2, 3}, Velocity{4, 5, 6});
+
+        ecs.addEntity(removedEntity);
+        ecs.addEntity(parent).addComponent(Position{7, 0, 0}).addComponent(Name{"parent"});
+        ecs.addEntity(child).addComponent(Health{42});
+        ecs.addEntity(sharingEntity).addComponent<Position>(parent);
+        ecs.appendChild(parent, child);
+        ecs.removeEntity(removedEntity);
+        childGUID = ecs.getEntityGUID(child);
+
+        ecs.saveSnapshot(snapshot);
+    }
+
+    BasicECS::ECS ecs;
+    ecs.addComponentType<Position>({});
+    ecs.addComponentType<Velocity>({});
+    ecs.addComponentType<Health>({});
+    ecs.addComponentType<Name>({.serializeFunc = serializeName, .deserializeFunc = deserializeName});
+
+    ecs.addEntity().addComponent(Health{0});
+    ecs.loadSnapshot(snapshot);
+
+    int count = 0;
+    bool matching = true;
+    ecs.forEach<Position, Velocity>([&](Position &pos, Velocity &vel){
+        count++;
+        matching = matching && pos.x == 1 && pos.y == 2 && pos.z == 3 && vel.dx == 4 && vel.dy == 5 && vel.dz == 6;
+    });
+
+    TEST_ASSERT(count == 1000);
+    TEST_ASSERT(matching);
+    TEST_ASSERT(ecs.isEntityValid(removedEntity) == false);
+    TEST_ASSERT(ecs.getComponent<Name>(parent).value == "parent");
+    TEST_ASSERT(ecs.getComponent<Position>(parent).x == 7);
+    TEST_ASSERT(ecs.getComponent<Position>(sharingEntity).x == 7);
+    TEST_ASSERT(ecs.getComponent<Health>(child).value == 42);
+    TEST_ASSERT(ecs.getParentEntityID(child) == parent);
+    TEST_ASSERT(ecs.getEntityID(childGUID) == child);
+
+    int healthCount = 0;
+    ecs.forEach<Health>([&healthCount](Health &health){
+        healthCount++;
+    });
+    TEST_ASSERT(healthCount == 1);
+
+    BasicECS::EntityID newEntity;
+    ecs.addEntity(newEntity);
+    TEST_ASSERT(newEntity != removedEntity);
+    TEST_ASSERT((newEntity & BasicECS::EntityIndexMask) == (removedEntity & BasicECS::EntityIndexMask));
+
+    return true;
+}
+
+bool mappedSnapshotTest(){
+    const std::string path = "mappedSnapshotTest.snapshot";
+    std::vector<BasicECS::EntityID> entities;
+    BasicECS::EntityID namedEntity;
+
+    {
+        BasicECS::ECS ecs;
+        ecs.addComponentType<Name>({.serializeFunc = serializeName, .deserializeFunc = deserializeName});
+
+        entities = ecs.createEntities(5000, Position{1, 2, 3}, Velocity{4, 5, 6});
+        for(std::size_t i = 0; i < entities.size(); i++){
+            ecs.getComponent<Position>(entities.at(i)).x = i;
+        }
+        ecs.addEntity(namedEntity).addComponent(Name{"named"}).addComponent(Position{-1, 0, 0});
+
+        ecs.saveSnapshot(path);
+    }
+
+    BasicECS::ECS ecs;
+    ecs.addComponentType<Position>({});
+    ecs.addComponentType<Velocity>({});
+    ecs.addComponentType<Name>({.serializeFunc = serializeName, .deserializeFunc = deserializeName});
+
+    ecs.loadSnapshot(path);
+
+    bool matching = true;
+    for(std::size_t i = 0; i < entities.size(); i++){
+        matching = matching && ecs.getComponent<Position>(entities.at(i)).x == i && ecs.getComponent<Velocity>(entities.at(i)).dz == 6;
+    }
+    TEST_ASSERT(matching);
+    TEST_ASSERT(ecs.getComponent<Name>(namedEntity).value == "named");
+    TEST_ASSERT(ecs.getComponent<Position>(namedEntity).x == -1);
+
+    // Changing the mapped chunks doesn't change the file
+    ecs.forEach<Position>([](Position &pos){
+        pos.y = 0;
+    });
+    for(std::size_t i = 0; i < 4000; i++){
+        ecs.removeEntity(entities.at(i));
+    }
+    ecs.createEntities(3000, Position{0, 0, 0}, Velocity{0, 0, 0});
+
+    int count = 0;
+    ecs.forEach<Position, Velocity>([&count](Position &pos, Velocity &vel){
+        count++;
+    });
+    TEST_ASSERT(count == 4000);
+
+    BasicECS::ECS reloadedEcs;
+    reloadedEcs.addComponentType<Position>({});
+    reloadedEcs.addComponentType<Velocity>({});
+    reloadedEcs.addComponentType<Name>({.serializeFunc = serializeName, .deserializeFunc = deserializeName});
+    reloadedEcs.loadSnapshot(path);
+
+    TEST_ASSERT(reloadedEcs.getComponent<Position>(entities.at(10)).y == 2);
+
+    // A truncated snapshot throws and leaves an empty world that can load again
+    std::string truncatedPath = path + ".truncated";
+    {
+        std::ifstream source(path, std::ios::binary);
+        std::string bytes((std::istreambuf_iterator<char>(source)), std::istreambuf_iterator<char>());
+        std::ofstream truncated(truncatedPath, std::ios::binary);
+        truncated.write(bytes.data(), bytes.size() - 16);
+    }
+    bool threw = false;
+    try{
+        reloadedEcs.loadSnapshot(truncatedPath);
+    }catch(const std::exception &exception){
+        threw = true;
+    }
+    TEST_ASSERT(threw);
+    count = 0;
+    reloadedEcs.forEach<Position>([&count](Position &pos){ count++; });
+    reloadedEcs.forEachEntity([&count](BasicECS::EntityID &entityID){ count++; });
+    TEST_ASSERT(count == 0);
+    reloadedEcs.loadSnapshot(path);
+    TEST_ASSERT(reloadedEcs.getComponent<Position>(entities.at(10)).y == 2);
+    std::remove(truncatedPath.c_str());
+
+    ecs.clear();
+    std::remove(path.c_str());
+
+    return true;
+}
+
+bool streamingSerializationTest(){
+    BasicECS::ECS ecs;
+    ecs.addComponentType<Name>({.serializeFunc = serializeName, .deserializeFunc = deserializeName});
+
+    std::vector<BasicECS::EntityID> entities = ecs.createEntities(100, Velocity{1, 2, 3});
+    for(std::size_t i = 0; i < entities.size(); i++){
+        ecs.getComponent<Velocity>(entities.at(i)).dx = i;
+        ecs.addComponent(entities.at(i), Name{"entity " + std::to_string(i)});
+    }
+
+    BasicECS::TypeID velocityTypeID = BasicECS::ECS::getTypeID<Velocity>();
+    BasicECS::TypeID nameTypeID = BasicECS::ECS::getTypeID<Name>();
+
+    std::vector<uint8_t> buffer;
+    BasicECS::Writer writer(buffer);
+    for(BasicECS::EntityID entity : entities){
+        ecs.serializeComponent(velocityTypeID, entity, writer);
+        ecs.serializeComponent(nameTypeID, entity, writer);
+    }
+
+    TEST_ASSERT(writer.getSize() == buffer.size());
+
+    std::vector<BasicECS::EntityID> copies = ecs.createEntities(100);
+
+    BasicECS::Reader reader(buffer);
+    for(BasicECS::EntityID copy : copies){
+        ecs.deserializeComponent(velocityTypeID, copy, reader);
+        ecs.deserializeComponent(nameTypeID, copy, reader);
+    }
+
+    TEST_ASSERT(reader.getRemaining() == 0);
+
+    bool matching = true;
+    for(std::size_t i = 0; i < copies.size(); i++){
+        matching = matching && ecs.getComponent<Velocity>(copies.at(i)).dx == i && ecs.getComponent<Velocity>(copies.at(i)).dz == 3;
+        matching = matching && ecs.getComponent<Name>(copies.at(i)).value == "entity " + std::to_string(i);
+    }
+    TEST_ASSERT(matching);
+
+    bool threw = false;
+    try{
+        BasicECS::Reader shortReader(buffer.data(), sizeof(Velocity) - 1);
+        ecs.deserializeComponent(velocityTypeID, copies.at(0), shortReader);
+    }catch(const std::exception &e){
+        threw = true;
+    }
+    TEST_ASSERT(threw);
+
+    return true;
+}
+
+bool deltaSnapshotTest(){
+    BasicECS::ECS server;
+    server.addComponentType<Name>({.serializeFunc = serializeName, .deserializeFunc = deserializeName});
+
+    std::vector<BasicECS::EntityID> entities = server.createEntities(100, Position{1, 2, 3}, Velocity{4, 5, 6});
+
+    BasicECS::EntityID named, healthy, sharingEntity;
+    server.addEntity(named).addComponent(Position{7, 0, 0}).addComponent(Name{"named"});
+    server.addEntity(healthy).addComponent(Health{42});
+    server.addEntity(sharingEntity).addComponent<Position>(named);
+
+    BasicECS::ECS client;
+    client.addComponentType<Position>({});
+    client.addComponentType<Velocity>({});
+    client.addComponentType<Health>({});
+    client.addComponentType<Name>({.serializeFunc = serializeName, .deserializeFunc = deserializeName});
+
+    std::stringstream fullDelta;
+    server.saveDelta(fullDelta, 0);
+    uint32_t sentTick = server.advanceChangeTick();
+    client.loadDelta(fullDelta);
+
+    auto onClient = [&](BasicECS::EntityID entityID){ return client.getEntityID(server.getEntityGUID(entityID)); };
+
+    int count = 0;
+    client.forEach<const Position, const Velocity>([&count](const Position &pos, const Velocity &vel){
+        count += pos.x == 1 && vel.dz == 6;
+    });
+    TEST_ASSERT(count == 100);
+    TEST_ASSERT(client.getComponent<Name>(onClient(named)).value == "named");
+    TEST_ASSERT(client.getComponent<Health>(onClient(healthy)).value == 42);
+    TEST_ASSERT(client.getComponent<Position>(onClient(sharingEntity)).x == 7);
+
+    // Reading doesn't change anything, writing only changes what is written
+    server.forEach<const Position, const Velocity>([](const Position &pos, const Velocity &vel){});
+    server.getComponent<const Health>(healthy);
+    TEST_ASSERT(server.getComponentTicks<Velocity>(entities.at(5)).changed <= sentTick);
+
+    server.getComponent<Velocity>(entities.at(5)).dx = 50;
+    server.getComponent<Position>(named).x = 8;
+    server.removeComponent<Health>(healthy);
+    server.removeEntity(entities.at(7));
+    BasicECS::EntityID newEntity;
+    server.addEntity(newEntity).addComponent(Health{3});
+
+    TEST_ASSERT(server.getComponentTicks<Velocity>(entities.at(5)).changed > sentTick);
+    TEST_ASSERT(server.getComponentTicks<Velocity>(entities.at(6)).changed <= sentTick);
+    TEST_ASSERT(server.getComponentTicks<Health>(newEntity).added > sentTick);
+
+    std::stringstream delta;
+    server.saveDelta(delta, sentTick);
+    TEST_ASSERT(delta.str().size() * 10 < fullDelta.str().size());
+
+    BasicECS::EntityGUID removedGUID = server.getEntityGUID(healthy);
+    client.loadDelta(delta);
+
+    TEST_ASSERT(client.getComponent<Velocity>(onClient(entities.at(5))).dx == 50);
+    TEST_ASSERT(client.getComponent<Velocity>(onClient(entities.at(6))).dx == 4);
+    TEST_ASSERT(client.getComponent<Position>(onClient(sharingEntity)).x == 8);
+    TEST_ASSERT(client.hasComponent<Health>(client.getEntityID(removedGUID)) == false);
+    TEST_ASSERT(client.getComponent<Health>(onClient(newEntity)).value == 3);
+
+    count = 0;
+    client.forEach<const Velocity>([&count](const Velocity &vel){ count++; });
+    TEST_ASSERT(count == 99);
+
+    // Nothing changed after the last delta so the next one is empty
+    sentTick = server.advanceChangeTick();
+    server.clearRemovals(sentTick);
+    std::stringstream emptyDelta;
+    server.saveDelta(emptyDelta, sentTick);
+    client.loadDelta(emptyDelta);
+    TEST_ASSERT(client.getComponent<Velocity>(onClient(entities.at(5))).dx == 50);
+
+    std::stringstream snapshot;
+    server.saveSnapshot(snapshot);
+    BasicECS::ECS loaded;
+    loaded.addComponentType<Position>({});
+    loaded.addComponentType<Velocity>({});
+    loaded.addComponentType<Health>({});
+    loaded.addComponentType<Name>({.serializeFunc = serializeName, .deserializeFunc = deserializeName});
+    loaded.loadSnapshot(snapshot);
+    TEST_ASSERT(loaded.getChangeTick() == server.getChangeTick());
+    TEST_ASSERT(loaded.getComponentTicks<Velocity>(entities.at(6)).changed == server.getComponentTicks<Velocity>(entities.at(6)).changed);
+    TEST_ASSERT(loaded.getComponentTicks<Name>(named).added == server.getComponentTicks<Name>(named).added);
+
+    // Unchanged chunks are skipped, a write through a resolved reference still marks its chunk
+    BasicECS::Reference<Velocity> reference = loaded.createReference<Velocity>(entities.at(20));
+    loaded.getComponent(reference);
+    uint32_t loadedTick = loaded.advanceChangeTick();
+    loaded.getComponent(reference).dx = 60;
+
+    std::stringstream loadedDelta;
+    loaded.saveDelta(loadedDelta, loadedTick);
+    TEST_ASSERT(loadedDelta.str().size() * 10 < fullDelta.str().size());
+    client.loadDelta(loadedDelta);
+    TEST_ASSERT(client.getComponent<Velocity>(onClient(entities.at(20))).dx == 60);
+
+    return true;
+}
+
+bool changeFilterTest(){
+    BasicECS::ECS ecs;
+    std::vector<BasicECS::EntityID> entities = ecs.createEntities(100, Position{0, 0, 0}, Velocity{1, 0, 0});
+
+    auto count = [&ecs](auto term, uint32_t sinceTick){
+        int count = 0;
+        ecs.forEach<decltype(term)>(sinceTick, [&count](auto &component){ count++; });
+        return count;
+    };
+
+    uint32_t tick = ecs.advanceChangeTick();
+    TEST_ASSERT(count(BasicECS::Changed<const Position>{}, tick) == 0);
+    TEST_ASSERT(count(BasicECS::Changed<const Position>{}, 0) == 100);
+
+    ecs.getComponent<Position>(entities.at(3)).x = 5;
+    ecs.addComponent(entities.at(4), Health{1});
+    ecs.removeComponent<Velocity>(entities.at(5));
+    ecs.removeEntity(entities.at(6));
+
+    std::vector<BasicECS::EntityID> changed;
+    ecs.forEach<BasicECS::Changed<const Position>>(tick, [&changed](const Position &pos, BasicECS::EntityID entityID){
+        changed.push_back(entityID);
+    });
+    TEST_ASSERT(changed.size() == 1 && changed.at(0) == entities.at(3));
+    TEST_ASSERT(count(BasicECS::Added<const Health>{}, tick) == 1);
+    TEST_ASSERT(count(BasicECS::Added<const Position>{}, tick) == 0);
+
+    std::vector<BasicECS::EntityID> removed;
+    ecs.forEachRemoved<Velocity>(tick, [&removed](BasicECS::EntityID entityID){ removed.push_back(entityID); });
+    TEST_ASSERT(removed.size() == 2 && removed.at(0) == entities.at(5) && removed.at(1) == entities.at(6));
+    ecs.clearRemovals(ecs.getChangeTick());
+    removed.clear();
+    ecs.forEachRemoved<Velocity>(tick, [&removed](BasicECS::EntityID entityID){ removed.push_back(entityID); });
+    TEST_ASSERT(removed.empty());
+
+    // Only the rows a filtered query passes on are marked
+    tick = ecs.advanceChangeTick();
+    ecs.forEach<const Position>([](const Position &pos){});
+    TEST_ASSERT(count(BasicECS::Changed<const Position>{}, tick) == 0);
+    ecs.getComponent<Velocity>(entities.at(10)).dx = 2;
+    ecs.forEach<Position, BasicECS::Changed<const Velocity>>(tick, [](Position &pos, const Velocity &vel){ pos.x = vel.dx; });
+    TEST_ASSERT(ecs.getComponent<const Position>(entities.at(10)).x == 2);
+    TEST_ASSERT(count(BasicECS::Changed<const Position>{}, tick) == 1);
+    ecs.forEach<Position>([](Position &pos){});
+    TEST_ASSERT(count(BasicECS::Changed<const Position>{}, tick) == 99);
+
+    // Shared components change with their owner
+    BasicECS::EntityID sharingEntity;
+    ecs.addEntity(sharingEntity).addComponent<Position>(entities.at(20));
+    tick = ecs.advanceChangeTick();
+    ecs.getComponent<Position>(entities.at(20)).y = 1;
+    TEST_ASSERT(count(BasicECS::Changed<const Position>{}, tick) == 2);
+
+    std::atomic<int> parallelCount(0);
+    ecs.parallelForEach<BasicECS::Changed<const Position>>(tick, [&parallelCount](const Position &pos){ parallelCount++; }, 16);
+    TEST_ASSERT(parallelCount == 2);
+
+    BasicECS::Scheduler scheduler(ecs);
+    std::vector<int> seenCounts;
+    scheduler.addSystem<BasicECS::Reads<Position>>("watch", [&seenCounts](BasicECS::ECS &ecs, uint32_t lastRunTick){
+        int count = 0;
+        ecs.forEach<BasicECS::Changed<const Position>>(lastRunTick, [&count](const Position &pos){ count++; });
+        seenCounts.push_back(count);
+    });
+    scheduler.addSystem<BasicECS::Reads<>, BasicECS::Writes<Position>>("move", [&entities](BasicECS::ECS &ecs){
+        ecs.getComponent<Position>(entities.at(30)).z++;
+    });
+
+    scheduler.runSystems();
+    scheduler.runSystems();
+    scheduler.runSystems();
+    TEST_ASSERT(seenCounts.size() == 3 && seenCounts.at(0) == 100 && seenCounts.at(1) == 1 && seenCounts.at(2) == 1);
+
+    return true;
+}
+
+class CountingAllocator : public BasicECS::Allocator{
+public:
+    void* allocate(std::size_t size, std::size_t alignment) override{
+        allocations++;
+        allocatedBytes += size;
+        return BasicECS::Allocator::getDefault().allocate(size, alignment);
+    }
+    void deallocate(void *memory, std::size_t size, std::size_t alignment) override{
+        deallocations++;
+        allocatedBytes -= size;
+        BasicECS::Allocator::getDefault().deallocate(memory, size, alignment);
+    }
+
+    int allocations = 0;
+    int deallocations = 0;
+    std::size_t allocatedBytes = 0;
+};
+
+bool allocatorTest(){
+    CountingAllocator allocator;
+
+    {
+        BasicECS::ECS ecs;
+        ecs.setAllocator(allocator);
+
+        std::vector<BasicECS::EntityID> entities = ecs.createEntities(10000, Position{1, 2, 3}, Velocity{4, 5, 6});
+        int allocations = allocator.allocations;
+        TEST_ASSERT(allocations > 0);
+
+        // Removed entities give their chunks back to the pool and new entities take them again
+        for(BasicECS::EntityID entityID : entities){
+            ecs.removeEntity(entityID);
+        }
+        entities = ecs.createEntities(10000, Position{1, 2, 3}, Velocity{4, 5, 6});
+        for(std::size_t i = 0; i < entities.size(); i += 2){
+            ecs.addComponent(entities.at(i), Health{1});
+        }
+        for(std::size_t i = 0; i < entities.size(); i += 2){
+            ecs.removeComponent<Health>(entities.at(i));
+        }
+        TEST_ASSERT(allocator.allocations == allocations);
+
+        int count = 0;
+        ecs.forEach<const Position, const Velocity>([&count](const Position &pos, const Velocity &vel){
+            count += pos.z == 3 && vel.dx == 4;
+        });
+        TEST_ASSERT(count == 10000);
+
+        ecs.clear();
+        ecs.createEntities(10000, Position{1, 2, 3});
+        TEST_ASSERT(allocator.allocations == allocations);
+        TEST_ASSERT(allocator.deallocations == 0);
+
+        // Components that don't fit in a pooled chunk get their own allocation
+        struct Big { uint8_t bytes[BasicECS::ArchetypeChunkSize * 2]; };
+        ecs.addEntity().addComponent(Big{});
+        TEST_ASSERT(allocator.allocations == allocations + 1);
+    }
+
+    TEST_ASSERT(allocator.deallocations == allocator.allocations);
+    TEST_ASSERT(allocator.allocatedBytes == 0);
+
+    return true;
+}
+
+bool stableComponentTest(){
+    BasicECS::ECS ecs;
+    ecs.addComponentType<Health>({.isStable = true});
+    ecs.addComponentType<Name>({.serializeFunc = serializeName, .deserializeFunc = deserializeName, .isStable = true});
+
+    std::vector<BasicECS::EntityID> entities;
+    std::vector<Health*> healths;
+    for(int i = 0; i < 1000; i++){
+        BasicECS::EntityID entityID;
+        ecs.addEntity(entityID).addComponent(Health{i}).addComponent(Name{std::to_string(i)});
+        entities.push_back(entityID);
+        healths.push_back(&ecs.getComponent<Health>(entityID));
+    }
+
+    // Rows move around the archetypes but stable components stay where they are
+    for(std::size_t i = 0; i < entities.size(); i += 2){
+        ecs.removeEntity(entities.at(i));
+    }
+    for(std::size_t i = 1; i < entities.size(); i += 4){
+        ecs.addComponent(entities.at(i), Position{1, 0, 0});
+    }
+    ecs.createEntities(500, Health{-1});
+
+    bool matching = true;
+    for(std::size_t i = 1; i < entities.size(); i += 2){
+        matching = matching && &ecs.getComponent<Health>(entities.at(i)) == healths.at(i) && healths.at(i)->value == (int)i;
+        matching = matching && ecs.getComponent<const Name>(entities.at(i)).value == std::to_string(i);
+    }
+    TEST_ASSERT(matching);
+
+    int count = 0;
+    ecs.forEach<Position, const Health>([&count](Position &pos, const Health &health){
+        count += (health.value - 1) % 4 == 0;
+    });
+    TEST_ASSERT(count == 250);
+
+    uint32_t tick = ecs.advanceChangeTick();
+    healths.at(3)->value = 30;
+    ecs.markChanged<Health>(entities.at(3));
+    count = 0;
+    ecs.forEach<BasicECS::Changed<const Health>>(tick, [&count](const Health &health){ count++; });
+    TEST_ASSERT(count == 1);
+
+    std::stringstream snapshot;
+    ecs.saveSnapshot(snapshot);
+    BasicECS::ECS loaded;
+    loaded.addComponentType<Position>({});
+    loaded.addComponentType<Health>({.isStable = true});
+    loaded.addComponentType<Name>({.serializeFunc = serializeName, .deserializeFunc = deserializeName, .isStable = true});
+    loaded.loadSnapshot(snapshot);
+    TEST_ASSERT(loaded.getComponent<Health>(entities.at(3)).value == 30);
+    TEST_ASSERT(loaded.getComponent<Name>(entities.at(5)).value == "5");
+
+    count = 0;
+    loaded.forEach<const Health>([&count](const Health &health){ count++; });
+    TEST_ASSERT(count == 1000);
+
+    // A type added again with another layout doesn't reuse the archetypes or edges of the old one
+    BasicECS::ECS relaid;
+    BasicECS::EntityID moving = relaid.createEntities(1, Velocity{1, 0, 0}).at(0);
+    relaid.addComponent(moving, Health{1});
+    relaid.removeComponent<Health>(moving);
+    relaid.removeComponentType<Health>();
+    relaid.addComponentType<Health>({.isStable = true});
+    relaid.addComponent(moving, Health{2});
+    Health *stableHealth = &relaid.getComponent<Health>(moving);
+    relaid.addComponent(moving, Position{0, 0, 0});
+    TEST_ASSERT(&relaid.getComponent<Health>(moving) == stableHealth && stableHealth->value == 2);
+    count = 0;
+    relaid.forEach<const Health, const Velocity>([&count](const Health &health, const Velocity &vel){ count += health.value; });
+    TEST_ASSERT(count == 2);
+
+    return true;
+}
+
+bool hierarchyTest(){
+    BasicECS::ECS ecs;
+
+    BasicECS::EntityID root, a, b, c, d;
+    ecs.addEntity(root).addEntity(a).addEntity(b).addEntity(c).addEntity(d);
+    ecs.appendChild(c, d).appendChild(root, a).appendChild(root, b).appendChild(a, c);
+
+    // Parents come before their children, level by level
+    std::vector<BasicECS::EntityID> order;
+    std::vector<BasicECS::EntityID> parents;
+    ecs.forEachInHierarchy([&](BasicECS::EntityID entityID, BasicECS::EntityID parentEntityID){
+        order.push_back(entityID);
+        parents.push_back(parentEntityID);
+    });
+    TEST_ASSERT((order == std::vector<BasicECS::EntityID>{root, a, b, c, d}));
+    TEST_ASSERT((parents == std::vector<BasicECS::EntityID>{BasicECS::RootEntityID, root, root, a, c}));
+
+    // Re-parenting takes the child from its old parent
+    ecs.appendChild(b, c);
+    TEST_ASSERT(ecs.getChildEntityIDs(a).empty());
+    TEST_ASSERT((ecs.getChildEntityIDs(b) == std::vector<BasicECS::EntityID>{c}));
+    TEST_ASSERT(ecs.getParentEntityID(c) == b);
+
+    bool isThrown = false;
+    try{
+        ecs.appendChild(d, b);
+    }catch(const std::exception &e){
+        isThrown = true;
+    }
+    TEST_ASSERT(isThrown);
+
+    // Removing a child unlinks it from the middle of its parent's children
+    BasicECS::EntityID e;
+    ecs.addEntity(e).appendChild(root, e);
+    ecs.removeEntity(b);
+    TEST_ASSERT((ecs.getChildEntityIDs(root) == std::vector<BasicECS::EntityID>{a, e}));
+    TEST_ASSERT(!ecs.isEntityValid(c) && !ecs.isEntityValid(d));
+
+    order.clear();
+    ecs.forEachInHierarchy([&](BasicECS::EntityID entityID, BasicECS::EntityID parentEntityID){
+        order.push_back(entityID);
+    });
+    TEST_ASSERT((order == std::vector<BasicECS::EntityID>{root, a, e}));
+
+    std::stringstream snapshot;
+    ecs.saveSnapshot(snapshot);
+    BasicECS::ECS loaded;
+    loaded.loadSnapshot(snapshot);
+    TEST_ASSERT((loaded.getChildEntityIDs(root) == std::vector<BasicECS::EntityID>{a, e}));
+    TEST_ASSERT(loaded.getParentEntityID(e) == root);
+
+    return true;
+}
+
+static int s_DeinitializedHealths = 0;
+
+bool subtreeRemovalTest(){
+    BasicECS::ECS ecs;
+    ecs.addComponentType<Health>({.deinitializeFunc = [](BasicECS::ECS &ecs, BasicECS::EntityID entityID){
+        s_DeinitializedHealths += ecs.getComponent<const Health>(entityID).value;
+    }});
+    ecs.addComponentType<Position>({});
+
+    // A chain deeper than the stack could handle recursively
+    std::vector<BasicECS::EntityID> chain = ecs.createEntities(200000, Health{1});
+    for(std::size_t i = 1; i < chain.size(); i++){
+        ecs.appendChild(chain.at(i - 1), chain.at(i));
+    }
+
+    BasicECS::EntityID other;
+    ecs.addEntity(other).addComponent(other, Position{}).addComponent(other, Health{1000});
+    ecs.appendChild(chain.at(10), other);
+
+    s_DeinitializedHealths = 0;
+    uint32_t tick = ecs.advanceChangeTick();
+    ecs.removeEntity(chain.at(5));
+
+    TEST_ASSERT(s_DeinitializedHealths == 199995 + 1000);
+    TEST_ASSERT(ecs.isEntityValid(chain.at(4)) && !ecs.isEntityValid(chain.at(5)) && !ecs.isEntityValid(other));
+    TEST_ASSERT(ecs.getChildEntityIDs(chain.at(4)).empty());
+
+    int count = 0;
+    ecs.forEachRemoved<Health>(tick, [&count](BasicECS::EntityID entityID){ count++; });
+    TEST_ASSERT(count == 199996);
+
+    count = 0;
+    ecs.forEach<const Health>([&count](const Health &health){ count++; });
+    TEST_ASSERT(count == 5);
+
+    // Overlapping subtrees are only removed once and the freed indexes are reused
+    BasicECS::EntityID a, b, c;
+    ecs.addEntity(a).addEntity(b).addEntity(c).appendChild(a, b).appendChild(b, c);
+    ecs.removeEntities({c, a, b, chain.at(0)});
+    TEST_ASSERT(!ecs.isEntityValid(a) && !ecs.isEntityValid(b) && !ecs.isEntityValid(c) && !ecs.isEntityValid(chain.at(4)));
+
+    std::vector<BasicECS::EntityID> reused = ecs.createEntities(200000, Health{2});
+    count = 0;
+    ecs.forEach<const Health>([&count](const Health &health){ count++; });
+    TEST_ASSERT(count == 200000);
+
+    return true;
+}
+
+struct LocalOffset { int value; };
+struct WorldOffset { int value; };
+
+bool propagateHierarchyTest(){
+    BasicECS::ECS ecs;
+    ecs.addComponentType<LocalOffset>({});
+    ecs.addComponentType<WorldOffset>({});
+
+    // Ten roots each with a hundred children each with ten children
+    std::vector<BasicECS::EntityID> roots = ecs.createEntities(10, LocalOffset{1}, WorldOffset{0});
+    std::vector<BasicECS::EntityID> middles;
+    std::vector<BasicECS::EntityID> leaves;
+    for(BasicECS::EntityID root : roots){
+        for(BasicECS::EntityID middle : ecs.createEntities(100, LocalOffset{10}, WorldOffset{0})){
+            ecs.appendChild(root, middle);
+            middles.push_back(middle);
+            for(BasicECS::EntityID leaf : ecs.createEntities(10, LocalOffset{100}, WorldOffset{0})){
+                ecs.appendChild(middle, leaf);
+                leaves.push_back(leaf);
+            }
+        }
+    }
+
+    std::atomic<int> visits = 0;
+    auto propagate = [&visits](const LocalOffset &local, const WorldOffset *parentWorld, WorldOffset &world){
+        world.value = local.value + (parentWorld != nullptr ? parentWorld->value : 0);
+        visits++;
+    };
+
+    ecs.propagateHierarchy<LocalOffset, WorldOffset>(0, propagate, 7);
+    TEST_ASSERT(visits == 11010);
+
+    bool matching = true;
+    for(BasicECS::EntityID leaf : leaves){
+        matching = matching && ecs.getComponent<const WorldOffset>(leaf).value == 111;
+    }
+    TEST_ASSERT(matching);
+
+    // Nothing changed so nothing is visited
+    uint32_t tick = ecs.advanceChangeTick();
+    visits = 0;
+    ecs.propagateHierarchy<LocalOffset, WorldOffset>(tick, propagate, 7);
+    TEST_ASSERT(visits == 0);
+
+    // Only the changed subtree is visited again
+    tick = ecs.advanceChangeTick();
+    ecs.getComponent<LocalOffset>(middles.at(0)).value = 20;
+    visits = 0;
+    ecs.propagateHierarchy<LocalOffset, WorldOffset>(tick, propagate, 7);
+    TEST_ASSERT(visits == 11);
+    TEST_ASSERT(ecs.getComponent<const WorldOffset>(leaves.at(0)).value == 121);
+    TEST_ASSERT(ecs.getComponent<const WorldOffset>(leaves.at(10)).value == 111);
+
+    // A moved entity is visited with its new parent
+    tick = ecs.advanceChangeTick();
+    ecs.appendChild(leaves.at(20), leaves.at(0));
+    visits = 0;
+    ecs.propagateHierarchy<LocalOffset, WorldOffset>(tick, propagate, 7);
+    TEST_ASSERT(visits == 1);
+    TEST_ASSERT(ecs.getComponent<const WorldOffset>(leaves.at(0)).value == 211);
+
+    // A Target written outside the propagation only revisits its children
+    tick = ecs.advanceChangeTick();
+    ecs.getComponent<WorldOffset>(middles.at(5)).value = 50;
+    visits = 0;
+    ecs.propagateHierarchy<LocalOffset, WorldOffset>(tick, propagate, 7);
+    TEST_ASSERT(visits == 10);
+    TEST_ASSERT(ecs.getComponent<const WorldOffset>(middles.at(5)).value == 50 && ecs.getComponent<const WorldOffset>(leaves.at(50)).value == 150);
+
+    return true;
+}
+
+struct MeshDescriptor { uint32_t mesh; uint32_t material; };
+
+static int s_DeinitializedMeshes = 0;
+
+bool sharedValueTest(){
+    BasicECS::ECS ecs;
+    ecs.addComponentType<MeshDescriptor>({.deinitializeFunc = [](BasicECS::ECS &ecs, BasicECS::EntityID entityID){
+        s_DeinitializedMeshes++;
+    }});
+
+    // Equal values share one copy
+    std::vector<BasicECS::EntityID> cubes = ecs.createEntities(1000, Position{0, 0, 0});
+    std::vector<BasicECS::EntityID> spheres = ecs.createEntities(1000, Position{0, 0, 0});
+    for(BasicECS::EntityID entityID : cubes){
+        ecs.addSharedComponent(entityID, MeshDescriptor{1, 2});
+    }
+    for(BasicECS::EntityID entityID : spheres){
+        ecs.addSharedComponent(entityID, MeshDescriptor{3, 4});
+    }
+    TEST_ASSERT(ecs.getSharerCount<MeshDescriptor>(cubes.at(0)) == 1000);
+    TEST_ASSERT(&ecs.getComponent<const MeshDescriptor>(cubes.at(0)) == &ecs.getComponent<const MeshDescriptor>(cubes.at(999)));
+
+    // The values themselves aren't entities of the queries
+    int count = 0;
+    ecs.forEach<const MeshDescriptor>([&count](const MeshDescriptor &mesh){ count++; });
+    TEST_ASSERT(count == 2000);
+
+    // Writing gives the entity its own copy
+    ecs.getComponent<MeshDescriptor>(cubes.at(0)).mesh = 9;
+    TEST_ASSERT(ecs.getComponent<const MeshDescriptor>(cubes.at(1)).mesh == 1);
+    TEST_ASSERT(ecs.getSharerCount<MeshDescriptor>(cubes.at(0)) == 1);
+    TEST_ASSERT(ecs.getSharerCount<MeshDescriptor>(cubes.at(1)) == 999);
+
+    ecs.addSharedComponent(cubes.at(0), MeshDescriptor{1, 2});
+    TEST_ASSERT(ecs.getSharerCount<MeshDescriptor>(cubes.at(1)) == 1000);
+    TEST_ASSERT(s_DeinitializedMeshes == 1);
+
+    // Non const query terms copy the value for each visited entity, the others keep sharing it
+    BasicECS::EntityID tagged = cubes.at(2);
+    ecs.addComponentType<Health>({});
+    ecs.addComponent(tagged, Health{1});
+    uint32_t tick = ecs.advanceChangeTick();
+    ecs.forEach<MeshDescriptor, BasicECS::Without<Health>>([&cubes](MeshDescriptor &mesh, BasicECS::EntityID entityID){
+        if(entityID == cubes.at(3)){
+            mesh.material = 7;
+        }
+    });
+    TEST_ASSERT(ecs.getComponent<const MeshDescriptor>(cubes.at(3)).material == 7);
+    TEST_ASSERT(ecs.getComponent<const MeshDescriptor>(cubes.at(4)).material == 2 && ecs.getComponent<const MeshDescriptor>(tagged).material == 2);
+    TEST_ASSERT(ecs.getSharerCount<MeshDescriptor>(tagged) == 1 && ecs.getSharerCount<MeshDescriptor>(cubes.at(4)) == 1);
+    count = 0;
+    ecs.forEach<BasicECS::Changed<const MeshDescriptor>>(tick, [&count](const MeshDescriptor &mesh){ count++; });
+    TEST_ASSERT(count == 1999);
+
+    bool threw = false;
+    try{
+        ecs.parallelForEach<MeshDescriptor>([](MeshDescriptor &mesh){});
+    }catch(const std::exception &exception){
+        threw = true;
+    }
+    TEST_ASSERT(threw);
+
+    // Systems that run at the same time can't copy shared values, exclusive systems can
+    BasicECS::JobSystem jobSystem(4);
+    BasicECS::ECS systemsECS;
+    systemsECS.setJobSystem(jobSystem);
+    std::vector<BasicECS::EntityID> entities = systemsECS.createEntities(100, Velocity{0, 0, 0});
+    for(BasicECS::EntityID entityID : entities){
+        systemsECS.addSharedComponent(entityID, MeshDescriptor{1, 2}).addSharedComponent(entityID, Position{0, 0, 0});
+    }
+    auto writeMeshes = [](BasicECS::ECS &ecs){
+        ecs.forEach<MeshDescriptor>([](MeshDescriptor &mesh){ mesh.material = 5; });
+    };
+    auto writePositions = [](BasicECS::ECS &ecs){
+        ecs.forEach<Position>([](Position &pos){ pos.x = 5; });
+    };
+
+    BasicECS::Scheduler scheduler(systemsECS);
+    scheduler.addSystem<BasicECS::Reads<>, BasicECS::Writes<MeshDescriptor>>("meshes", writeMeshes);
+    scheduler.addSystem<BasicECS::Reads<>, BasicECS::Writes<Position>>("positions", writePositions);
+    TEST_ASSERT(scheduler.getSystemBatches().size() == 1);
+
+    threw = false;
+    try{
+        scheduler.runSystems();
+    }catch(const std::exception &exception){
+        threw = true;
+    }
+    TEST_ASSERT(threw);
+    TEST_ASSERT(systemsECS.getSharerCount<MeshDescriptor>(entities.at(0)) == 100 && systemsECS.getComponent<const Position>(entities.at(0)).x == 0);
+
+    BasicECS::Scheduler exclusiveScheduler(systemsECS);
+    exclusiveScheduler.addExclusiveSystem("meshes", writeMeshes);
+    exclusiveScheduler.addExclusiveSystem("positions", writePositions);
+    exclusiveScheduler.runSystems();
+    TEST_ASSERT(systemsECS.getComponent<const MeshDescriptor>(entities.at(0)).material == 5 && systemsECS.getComponent<const Position>(entities.at(99)).x == 5);
+    TEST_ASSERT(systemsECS.getSharerCount<MeshDescriptor>(entities.at(0)) == 1);
+
+    // Equal values share again when they are added again
+    ecs.removeComponentType<Health>();
+    for(BasicECS::EntityID entityID : cubes){
+        ecs.addSharedComponent(entityID, MeshDescriptor{1, 2});
+    }
+    for(BasicECS::EntityID entityID : spheres){
+        ecs.addSharedComponent(entityID, MeshDescriptor{3, 4});
+    }
+    TEST_ASSERT(ecs.getSharerCount<MeshDescriptor>(cubes.at(1)) == 1000 && ecs.getSharerCount<MeshDescriptor>(spheres.at(1)) == 1000);
+
+    // The value goes with its last sharer
+    s_DeinitializedMeshes = 0;
+    ecs.removeEntities(std::vector<BasicECS::EntityID>(spheres.begin(), spheres.end() - 1));
+    TEST_ASSERT(s_DeinitializedMeshes == 0);
+    ecs.removeComponent<MeshDescriptor>(spheres.back());
+    TEST_ASSERT(s_DeinitializedMeshes == 1);
+
+    // Sharers of an entity keep the component when the entity is removed
+    BasicECS::EntityID owner, sharer;
+    ecs.addEntity(owner).addComponent(Velocity{1, 2, 3});
+    ecs.addEntity(sharer).addComponent<Velocity>(owner);
+    TEST_ASSERT(ecs.getSharerCount<Velocity>(owner) == 2);
+    ecs.removeEntity(owner);
+    TEST_ASSERT(ecs.getComponent<const Velocity>(sharer).dz == 3);
+    TEST_ASSERT(ecs.getSharerCount<Velocity>(sharer) == 1);
+
+    std::stringstream snapshot;
+    ecs.saveSnapshot(snapshot);
+    BasicECS::ECS loaded;
+    loaded.addComponentType<Position>({});
+    loaded.addComponentType<Velocity>({});
+    loaded.addComponentType<MeshDescriptor>({});
+    loaded.loadSnapshot(snapshot);
+
+    count = 0;
+    loaded.forEach<const MeshDescriptor>([&count](const MeshDescriptor &mesh){ count++; });
+    TEST_ASSERT(count == 1000);
+    TEST_ASSERT(loaded.getComponent<const Velocity>(sharer).dx == 1);
+
+    BasicECS::EntityID newCube;
+    loaded.addEntity(newCube).addSharedComponent(MeshDescriptor{1, 2});
+    TEST_ASSERT(loaded.getSharerCount<MeshDescriptor>(cubes.at(5)) == 1001);
+
+    std::stringstream delta;
+    ecs.saveDelta(delta, 0);
+    BasicECS::ECS client;
+    client.addComponentType<Position>({});
+    client.addComponentType<Velocity>({});
+    client.addComponentType<MeshDescriptor>({});
+    client.loadDelta(delta);
+
+    count = 0;
+    client.forEach<const MeshDescriptor>([&count](const MeshDescriptor &mesh){ count++; });
+    TEST_ASSERT(count == 1000);
+
+    return true;
+}
+
+bool cachedQueryTest(){
+    BasicECS::ECS ecs;
+    BasicECS::Query<Position, const Velocity> moving = ecs.createQuery<Position, const Velocity>();
+    TEST_ASSERT(moving.count() == 0);
+
+    // Archetypes created after the query are matched
+    std::vector<BasicECS::EntityID> entities = ecs.createEntities(50, Position{0, 0, 0}, Velocity{1, 0, 0});
+    ecs.createEntities(20, Position{0, 0, 0});
+    ecs.createEntities(30, Position{0, 0, 0}, Velocity{2, 0, 0}, Health{10});
+    TEST_ASSERT(moving.count() == 80);
+
+    moving.forEach([](Position &pos, const Velocity &vel){ pos.x += vel.dx; });
+    float xSum = 0;
+    ecs.forEach<const Position>([&xSum](const Position &pos){ xSum += pos.x; });
+    TEST_ASSERT(xSum == 110);
+
+    // Queries with the same components share a cache
+    BasicECS::Query<const Position, Velocity> sameComponents = ecs.createQuery<const Position, Velocity>();
+    TEST_ASSERT(sameComponents.count() == 80);
+
+    uint32_t tick = ecs.advanceChangeTick();
+    ecs.getComponent<Velocity>(entities.at(7)).dx = 3;
+    BasicECS::Query<BasicECS::Changed<const Velocity>> changedVelocities = ecs.createQuery<BasicECS::Changed<const Velocity>>();
+    std::vector<BasicECS::EntityID> changed;
+    changedVelocities.forEach(tick, [&changed](const Velocity &vel, BasicECS::EntityID entityID){ changed.push_back(entityID); });
+    TEST_ASSERT(changed.size() == 1 && changed.at(0) == entities.at(7));
+
+    std::atomic<int> parallelCount(0);
+    moving.parallelForEach([&parallelCount](Position &pos, const Velocity &vel){ parallelCount++; }, 16);
+    TEST_ASSERT(parallelCount == 80);
+
+    ecs.removeComponent<Velocity>(entities.at(0));
+    ecs.addComponent(entities.at(1), Health{5});
+    TEST_ASSERT(moving.count() == 79);
+
+    // Queries can be used for the first time from systems that run at the same time
+    BasicECS::JobSystem jobSystem(4);
+    ecs.setJobSystem(jobSystem);
+    BasicECS::Scheduler scheduler(ecs);
+    std::atomic<int> reads(0);
+    scheduler.addSystem<BasicECS::Reads<Position>>("positions", [&reads](BasicECS::ECS &ecs){
+        ecs.forEach<const Position, BasicECS::Without<Health>>([&reads](const Position &pos){ reads++; });
+    });
+    scheduler.addSystem<BasicECS::Reads<Velocity>>("velocities", [&reads](BasicECS::ECS &ecs){
+        ecs.forEach<const Velocity, BasicECS::Without<Health>>([&reads](const Velocity &vel){ reads++; });
+    });
+    scheduler.addSystem<BasicECS::Reads<Health>>("healths", [&reads](BasicECS::ECS &ecs){
+        ecs.forEach<const Health, BasicECS::Without<Velocity>>([&reads](const Health &health){ reads++; });
+    });
+    scheduler.addSystem<BasicECS::Reads<Position, Health>>("both", [&reads](BasicECS::ECS &ecs){
+        ecs.forEach<const Position, const Health, BasicECS::Optional<const Velocity>>([&reads](const Position &pos, const Health &health, const Velocity *vel){ reads++; });
+    });
+    scheduler.runSystems();
+    TEST_ASSERT(reads == 69 + 48 + 0 + 31);
+
+    return true;
+}
+
+bool queryTermsTest(){
+    BasicECS::ECS ecs;
+    std::vector<BasicECS::EntityID> still = ecs.createEntities(10, Position{0, 0, 0});
+    std::vector<BasicECS::EntityID> moving = ecs.createEntities(20, Position{0, 0, 0}, Velocity{1, 0, 0});
+    std::vector<BasicECS::EntityID> hurt = ecs.createEntities(30, Position{0, 0, 0}, Velocity{2, 0, 0}, Health{5});
+    std::vector<BasicECS::EntityID> named = ecs.createEntities(5, Health{7}, Name{"named"});
+
+    int count = 0;
+    ecs.forEach<const Position, BasicECS::Without<Velocity>>([&count](const Position &pos){ count++; });
+    TEST_ASSERT(count == 10);
+
+    count = 0;
+    int velocityCount = 0;
+    ecs.forEach<Position, BasicECS::Optional<const Velocity>>([&](Position &pos, const Velocity *vel, BasicECS::EntityID entityID){
+        count++;
+        if(vel != nullptr){
+            velocityCount++;
+            pos.x = vel->dx;
+        }
+    });
+    TEST_ASSERT(count == 60 && velocityCount == 50);
+    TEST_ASSERT(ecs.getComponent<const Position>(hurt.at(3)).x == 2 && ecs.getComponent<const Position>(still.at(3)).x == 0);
+
+    count = 0;
+    ecs.forEach<BasicECS::AnyOf<Velocity, Name>, BasicECS::Optional<Health>>([&count](Health *health){ count += health != nullptr ? health->value : 0; });
+    TEST_ASSERT(count == 30 * 5 + 5 * 7);
+
+    count = 0;
+    ecs.forEach<Health, BasicECS::Without<Name>, BasicECS::AnyOf<Position>>([&count](Health &health){ count++; });
+    TEST_ASSERT(count == 30);
+
+    // Only the optional components an entity has are marked as changed
+    uint32_t tick = ecs.advanceChangeTick();
+    ecs.forEach<BasicECS::Optional<Velocity>, BasicECS::Without<Health>>([](Velocity *vel){});
+    count = 0;
+    ecs.forEach<BasicECS::Changed<const Velocity>>(tick, [&count](const Velocity &vel){ count++; });
+    TEST_ASSERT(count == 20);
+
+    std::atomic<int> parallelCount(0);
+    ecs.parallelForEach<const Position, BasicECS::Without<Health>>([&parallelCount](const Position &pos){ parallelCount++; }, 4);
+    TEST_ASSERT(parallelCount == 30);
+
+    // Cached queries match new archetypes with the same terms
+    BasicECS::Query<const Position, BasicECS::Without<Velocity>> idle = ecs.createQuery<const Position, BasicECS::Without<Velocity>>();
+    TEST_ASSERT(idle.count() == 10);
+    ecs.addComponent(still.at(0), Name{"still"});
+    ecs.removeComponent<Velocity>(moving.at(0));
+    TEST_ASSERT(idle.count() == 11);
+
+    return true;
+}
+
 double timeSinceEpochMillisec() {
     using namespace std::chrono;
     uint64_t nano = duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
@@ -494,4 +2052,62 @@ void basicEcsSpeedTest(int amount){
 
     std::cout << "BasicECS time: " << timeSinceEpochMillisec() - startTime << "ms\n";
 
+    startTime = timeSinceEpochMillisec();
+
+    ecs.parallelForEach<Velocity>([](Velocity &velocity){
+        velocity.dx += 9;
+    });
+
+    std::cout << "BasicECS parallel time: " << timeSinceEpochMillisec() - startTime << "ms\n";
+
+}
+
+void basicEcsRemovalSpeedTest(int amount){
+    BasicECS::ECS ecs;
+
+    ecs.addComponentType<Position>({});
+    ecs.addComponentType<Velocity>({});
+
+    std::vector<BasicECS::EntityID> entities;
+    entities.reserve(amount);
+
+    for(int i = 0; i < amount; i++){
+        BasicECS::EntityID testEnt;
+        ecs.addEntity(testEnt)
+            .addComponent<Position>(testEnt, {0, 1, 20})
+            .addComponent<Velocity>(testEnt, {0,0,0});
+        entities.push_back(testEnt);
+    }
+
+    double startTime = timeSinceEpochMillisec();
+
+    for(int i = 0; i < amount; i++){
+        ecs.removeComponent<Velocity>(entities.at(i));
+    }
+
+    std::cout << "BasicECS remove time (" << amount << " components): " << timeSinceEpochMillisec() - startTime << "ms\n";
+}
+
+void basicEcsSpawnSpeedTest(int amount){
+    BasicECS::ECS ecs;
+
+    ecs.addComponentType<Position>({});
+    ecs.addComponentType<Velocity>({});
+
+    double startTime = timeSinceEpochMillisec();
+
+    for(int i = 0; i < amount; i++){
+        ecs.addEntity()
+            .addComponent(Position{0, 1, 20})
+            .addComponent(Velocity{0, 0, 0});
+    }
+
+    std::cout << "BasicECS spawn time (" << amount << " entities): " << timeSinceEpochMillisec() - startTime << "ms\n";
+
+    ecs.clear();
+    startTime = timeSinceEpochMillisec();
+
+    ecs.createEntities(amount, Position{0, 1, 20}, Velocity{0, 0, 0});
+
+    std::cout << "BasicECS bulk spawn time (" << amount << " entities): " << timeSinceEpochMillisec() - startTime << "ms\n";
 }
\ No newline at end of file
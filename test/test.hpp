@@ -29,6 +29,10 @@ void logTestResult(bool result, const char* testName) {
 
 void basicEcsSpeedTest(int amount);
 
+void basicEcsRemovalSpeedTest(int amount);
+
+void basicEcsSpawnSpeedTest(int amount);
+
 bool createEntitiesTest();
 
 bool addingComponentTest();
@@ -55,4 +59,54 @@ bool parentingTest();
 
 bool clearingTest();
 
-bool removingEntityTest();
\ No newline at end of file
+bool removingEntityTest();
+
+bool archetypeTest();
+
+bool variadicForEachTest();
+
+bool componentChurnTest();
+
+bool componentMapTest();
+
+bool hasComponentTest();
+
+bool denseTypeIDTest();
+
+bool parallelForEachTest();
+
+bool schedulerTest();
+
+bool commandBufferTest();
+
+bool bulkCreationTest();
+
+bool entityGenerationTest();
+
+bool referenceCachingTest();
+
+bool snapshotTest();
+
+bool mappedSnapshotTest();
+
+bool streamingSerializationTest();
+
+bool deltaSnapshotTest();
+
+bool changeFilterTest();
+
+bool allocatorTest();
+
+bool stableComponentTest();
+
+bool hierarchyTest();
+
+bool subtreeRemovalTest();
+
+bool propagateHierarchyTest();
+
+bool sharedValueTest();
+
+bool cachedQueryTest();
+
+bool queryTermsTest();
\ No newline at end of file